@@ -1,13 +1,21 @@
 #!/bin/bash
 
-SBATCH --partition=general
-SBATCH --ntasks=5
-SBATCH --nodes=1
-SBATCH --cpus-per-task=1
-SBATCH --time=00:5:00
-SBATCH --job-ryancey_game_of_life
+#SBATCH --partition=general
+#SBATCH --ntasks=4
+#SBATCH --nodes=1
+#SBATCH --cpus-per-task=4
+#SBATCH --time=00:5:00
+#SBATCH --job-name=ryancey_game_of_life
 
 module load openmpi
 module load gcc/10.2.0
 
-mpirun -np 5 ./run
\ No newline at end of file
+# One rank per NUMA domain, each bound to its own set of cores, with its
+# OpenMP threads pinned inside that set. The cartesian communicator will
+# then place grid neighbours on the same node, and every sector is first
+# touched by the threads that update it, so its memory stays local.
+export OMP_NUM_THREADS=$SLURM_CPUS_PER_TASK
+export OMP_PROC_BIND=close
+export OMP_PLACES=cores
+
+mpirun -np $SLURM_NTASKS --map-by numa:PE=$SLURM_CPUS_PER_TASK --bind-to core ./run --pin
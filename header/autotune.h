@@ -0,0 +1,36 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "config.h"
+#include "topology.h"
+#include "sector.h"
+
+/// ---------------------------------
+/// The engine settings that are picked at startup.
+/// Halo depth is fixed at one cell and there is a single transport, so
+/// neither is a choice yet.
+struct Tuning {
+    int kernel;     // index into kernels (kernel.h)
+    int tile;       // cache block side, for tiled kernels
+    int threads;    // OpenMP threads per rank
+};
+
+/// The settings asked for on the command line, with defaults for the rest.
+Tuning configured_tuning(const Config& config, int rank);
+
+/// Times every candidate Tuning on this rank's real sector for
+/// config.tune_generations generations each, without advancing it, and
+/// returns the one whose slowest rank was fastest. Settings fixed on the
+/// command line (--kernel, --tile, --threads) are not varied. Thread counts
+/// are tried up to the smallest thread limit of any rank.
+///
+/// The winner is stored in config.tune_cache under a key made of the CPU
+/// model, core count, thread limit, sector width, rank count and the fixed
+/// settings. A later run with the same key reads it back without running
+/// any benchmark. Collective over topo.comm: every rank gets the same answer.
+Tuning autotune(const Topology& topo, const Config& config, Sector& s);
+
+/// Points the sector at the chosen kernel and sets the OpenMP thread count.
+void apply_tuning(const Tuning& tuning, Sector& s);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef CENSUS_H
+#define CENSUS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "topology.h"
+#include "sector.h"
+
+/// ---------------------------------
+/// Census of the objects in the world: the groups of live cells connected
+/// through any of their eight neighbours, however many sectors they span.
+///
+/// Every rank labels its own sector with a union-find pass and gives its
+/// objects labels that are unique across the world. The labels along the
+/// edges of the sector then go to the neighbours, so every rank can see
+/// which of its objects touch which of its neighbours'. Only those objects
+/// (and the pairs of labels that touch) go to rank 0 to be merged; objects
+/// entirely inside one sector are summarised where they are, and only the
+/// summary is sent.
+///
+/// A census needs 4 bytes per cell while it runs, and cells are numbered
+/// with 32 bit indices, so sectors wider than 46340 cells are not supported
+/// (parse_args turns --census off for them).
+///
+/// Rank 0 prints the number of objects, a histogram of their sizes, and the
+/// largest ones with their bounding boxes. Objects of equal size are listed
+/// top to bottom, then left to right, whatever the process grid.
+struct Census {
+    int width;
+    int top;                        // how many of the largest objects to list
+
+    /// Global labels of the edge cells, -1 for dead ones: the top and bottom
+    /// rows and the west and east columns, width cells each.
+    std::vector<int64_t> north, south, west, east;
+
+    /// The neighbours' labels around the sector. The ghost rows are
+    /// width + 2 long and include the corners.
+    std::vector<int64_t> ghost_north, ghost_south, ghost_west, ghost_east;
+};
+
+Census census_create(const Sector& s, int top);
+void census_free(Census& census);
+
+/// Takes the census of the current generation. Collective over topo.comm.
+void census_run(Census& census, const Topology& topo, const Sector& s, long generation);
+
+#endif
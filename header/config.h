@@ -0,0 +1,69 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <vector>
+
+/// ---------------------------------
+/// Runtime configuration.
+/// The defaults are the old compile time constants. Every field can be
+/// overridden from the command line, for example:
+///
+///     mpirun -np 4 ./run --width 512 --runtime 1000 --pin
+///     ./run --replay logs 500 --output frame.pbm
+struct Config {
+    int sector_width = 20;  // cells per side of each rank's sector
+    int runtime = 100;      // generations to simulate
+    int density = 6;        // a cell starts alive with a 1 in density chance
+    unsigned seed = 0;      // seed for the initial world
+    bool pin = false;       // pin OpenMP threads to the cores of their rank
+    bool report = true;     // print the rank / core / NUMA mapping at startup
+    double progress = 0;    // seconds between progress lines from rank 0, 0 for none
+    int view_every = 0;     // generations between ASCII views of the world, 0 for none
+    int view_columns = 64;  // widest the ASCII view may be
+
+    std::string log_dir;        // write a delta log per rank here, empty for none
+    int keyframe_every = 64;    // generations between keyframes in the delta log
+
+    /// Replay mode: rebuild generation replay_generation from the delta logs
+    /// in replay_dir and write it to replay_output, instead of simulating.
+    std::string replay_dir;
+    long replay_generation = 0;
+    std::string replay_output = "replay.pbm";
+
+    /// Out-of-core mode: keep each sector bit-packed in memory mapped files
+    /// in this directory and stream it through `band` rows at a time.
+    std::string out_of_core_dir;
+    int band = 64;
+
+    /// Engine settings. Zero or empty means the default, or with --autotune,
+    /// "let the autotuner choose".
+    std::string kernel;     // kernel name, see kernel.h
+    int tile = 0;           // cache block side for tiled kernels
+    int threads = 0;        // OpenMP threads per rank
+    bool dataflow = false;  // run tiles as a task graph instead of generation by generation
+
+    /// Autotuning: benchmark the candidate settings at startup, or reuse the
+    /// cached result for this machine and problem size.
+    bool tune = false;
+    std::string tune_cache = "autotune.cache";
+    int tune_generations = 3;
+
+    /// Ensemble mode: run `worlds` independent worlds of ensemble_width
+    /// squared cells instead of one big one. World i starts with density
+    /// densities[i % densities.size()], which defaults to just `density`.
+    bool ensemble = false;
+    long worlds = 1024;
+    int ensemble_width = 32;
+    std::vector<int> densities;
+    std::string ensemble_output;    // CSV of every world, empty for none
+
+    int census_every = 0;   // generations between object censuses, 0 for none
+    int census_top = 5;     // how many of the largest objects a census lists
+};
+
+/// Reads the command line into a Config. Unknown or malformed flags are
+/// reported by rank 0 and otherwise ignored.
+Config parse_args(int argc, char* argv[], int rank);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include "sector.h"
+#include "halo.h"
+
+/// ---------------------------------
+/// Runs several generations of an in-core sector as a task graph instead
+/// of one generation at a time.
+///
+/// The sector is cut into s.tile x s.tile tiles. Computing tile (i, j) of
+/// generation t + 1 is an OpenMP task that depends only on the nine tiles
+/// around it at generation t, and for tiles on the sector border, on the
+/// halo exchange of generation t, which is itself a task that depends on
+/// the border tiles. So the middle of the sector keeps going while a halo
+/// is in flight, quick regions run ahead of slow ones, and idle threads
+/// pick up whatever tile is ready.
+///
+/// Tasks of generation t + 2 write the buffer generation t lives in; the
+/// dependencies already make them wait until every reader of generation t
+/// is finished, so two buffers are still enough.
+///
+/// Each tile task runs s.serial_kernel, the single thread form of the
+/// chosen kernel, since s.kernel would open a parallel region of its own.
+///
+/// MPI calls are made from inside tasks, one at a time, so MPI must have
+/// been initialised with at least MPI_THREAD_SERIALIZED. The halo task polls
+/// with a task yield between tests rather than blocking in MPI_Waitall.
+void dataflow_run(Sector& s, Halo halo[2], int generations);
+
+#endif
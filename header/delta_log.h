@@ -0,0 +1,48 @@
+#ifndef DELTA_LOG_H
+#define DELTA_LOG_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "topology.h"
+#include "sector.h"
+
+/// ---------------------------------
+/// Append-only record of how the world evolves.
+/// Every rank writes its own file, <dir>/rank_<cart rank>.gol, so logging
+/// needs no coordination between ranks and runs fully in parallel.
+///
+/// Each generation becomes one record holding the cells that flipped since
+/// the one before, as the gaps between flipped positions (row major within
+/// the sector) written with a Golomb-Rice code tuned to the mean gap. Once
+/// the world settles a generation costs a handful of bytes. Every
+/// keyframe_every generations a keyframe is written instead: the same
+/// encoding taken against an empty sector, so replay never has to start
+/// further back than that.
+///
+/// Files are written in the byte order of the machine that ran the simulation.
+struct DeltaLog {
+    FILE* file;
+    int keyframe_every;
+    std::vector<byte> bits;
+};
+
+/// Creates the log for this rank (making dir if needed) and writes the
+/// current generation as keyframe 0. Collective over topo.comm.
+DeltaLog delta_log_open(const std::string& dir, const Topology& topo, const Sector& s, int keyframe_every);
+void delta_log_close(DeltaLog& log);
+
+/// Appends generation `generation`, which must be the current one of the
+/// sector and follow the last one recorded. Call after sector_swap.
+void delta_log_record(DeltaLog& log, const Sector& s, long generation);
+
+/// Rebuilds the whole world at `generation` from the rank logs in dir,
+/// starting at the nearest keyframe, and writes it to `output` as a PBM
+/// image. Only the logs of the run rank_0.gol belongs to are read, and they
+/// must cover its process grid exactly once. Runs on one process. Returns
+/// false, after saying why, on failure, including on damaged records.
+bool delta_log_replay(const std::string& dir, long generation, const std::string& output);
+
+#endif
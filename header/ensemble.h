@@ -0,0 +1,48 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "mpi.h"
+#include "config.h"
+
+/// ---------------------------------
+/// Ensemble mode: many small, independent worlds instead of one big one,
+/// for random soup searches.
+///
+/// Worlds are bit-sliced 64 to a batch: every cell of a batch is a 64 bit
+/// word whose bit i is that cell in world i, so one pass of a bitwise
+/// adder kernel advances all 64 worlds at once. Each world stops on its own
+/// when it dies out or settles into a still life or period 2 oscillator,
+/// and the batch stops when all of its worlds have, or at config.runtime.
+///
+/// Rank 0 hands out ranges of worlds on request to the other ranks, which
+/// run them a batch per thread, so faster ranks simply take more work.
+/// Between requests rank 0 runs ranges of its own, so it is never idle
+/// while there is work left; with a single rank it runs everything.
+enum Outcome : int32_t {
+    OUTCOME_DIED,           // no live cells left
+    OUTCOME_STILL,          // unchanged from the generation before
+    OUTCOME_OSCILLATOR,     // same as two generations before
+    OUTCOME_ACTIVE          // still changing at config.runtime
+};
+
+struct WorldResult {
+    int64_t world;
+    int32_t density;        // started with a 1 in density chance per cell
+    int32_t generation;     // when the outcome was detected
+    int32_t population;     // live cells at that generation
+    int32_t outcome;
+};
+
+/// Runs config.worlds worlds of config.ensemble_width squared cells, with
+/// densities cycling through config.densities, and prints a summary per
+/// density on rank 0 (and every world to config.ensemble_output if set).
+/// Collective over comm.
+void run_ensemble(const Config& config, MPI_Comm comm);
+
+/// Runs worlds [first, first + count), count <= 64, as one bit-sliced batch.
+void run_batch(const Config& config, long first, int count, std::vector<WorldResult>& results);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef HALO_H
+#define HALO_H
+
+#include "mpi.h"
+#include "topology.h"
+
+/// Tags name the direction a message travels in, so a rank that neighbours
+/// another on more than one side cannot mix the messages up. Messages with
+/// the same tag between two ranks never overtake each other, so a
+/// neighbour that runs a generation ahead cannot be confused either.
+/// Every exchange of edges between grid neighbours uses them.
+enum HaloTag {
+    TAG_WEST, TAG_EAST, TAG_NORTH, TAG_SOUTH,
+    TAG_NORTH_WEST, TAG_NORTH_EAST, TAG_SOUTH_WEST, TAG_SOUTH_EAST
+};
+
+/// ---------------------------------
+/// Persistent halo exchange for one buffer of a square grid with a one cell
+/// ghost ring (width x width interior, rows `stride` elements apart).
+///
+/// Every neighbour, corners included, is contacted directly in a single
+/// round, so the exchange only ever waits on the up to eight ranks that
+/// share an edge or corner with this one. There is no global step: a rank
+/// starts a generation as soon as its own neighbours have sent their edges
+/// for the previous one. Neighbours can therefore be at most one generation
+/// apart, and ranks d hops apart at most d generations.
+///
+/// halo_start posts the transfers and returns immediately, so the interior
+/// of the sector can be computed while the edges are in flight;
+/// halo_finish waits for them, halo_test only checks.
+///
+/// The element type is a parameter so the same exchange can move cells
+/// or anything else laid out like them.
+struct Halo {
+    MPI_Datatype column;
+    MPI_Datatype row;
+    MPI_Request requests[16];
+};
+
+/// Creates the persistent requests for the grid that starts at base.
+void halo_create(Halo& halo, const Topology& topo, void* base, int width, int stride, MPI_Datatype element);
+void halo_free(Halo& halo);
+
+void halo_start(Halo& halo);
+void halo_finish(Halo& halo);
+
+/// Whether every transfer posted by halo_start has completed, in which case
+/// the exchange is finished just as by halo_finish. Never waits.
+bool halo_test(Halo& halo);
+
+/// ---------------------------------
+/// One-off exchange of separately stored edges, for data that is not kept
+/// with a ghost ring around it. Same neighbours, tags and single round as
+/// the persistent exchange above, but nothing is set up in advance.
+///
+/// north, south, west and east are this rank's edge rows and columns,
+/// width elements each. ghost_north and ghost_south receive the rows
+/// above and below with the corners, width + 2 elements; ghost_west and
+/// ghost_east the columns beside, width elements. Ghosts at the edge of the
+/// world are left as they were. Returns once everything has arrived.
+void halo_exchange_edges(const Topology& topo, int width, MPI_Datatype element,
+                         const void* north, const void* south, const void* west, const void* east,
+                         void* ghost_north, void* ghost_south, void* ghost_west, void* ghost_east);
+
+#endif
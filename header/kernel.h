@@ -0,0 +1,31 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <string>
+
+#include "sector.h"
+
+/// ---------------------------------
+/// The interchangeable ways of computing a generation of an in-core sector.
+/// They all give the same result; which is fastest depends on the machine
+/// and the sector size, which is what the autotuner is for.
+struct KernelInfo {
+    const char* name;
+    Kernel step;
+
+    /// The same computation on the calling thread only, for callers that
+    /// already spread the work over threads themselves.
+    Kernel serial;
+
+    /// Whether the kernel reads Sector::tile, so the tuner knows to vary it.
+    bool tiled;
+};
+
+/// Every kernel, the default first.
+extern const KernelInfo kernels[];
+extern const int kernel_count;
+
+/// Index of the kernel with this name, or -1.
+int find_kernel(const std::string& name);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef OUT_OF_CORE_H
+#define OUT_OF_CORE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "mpi.h"
+#include "topology.h"
+#include "sector.h"
+
+/// ---------------------------------
+/// A sector that lives on disk instead of in memory, for worlds bigger than
+/// the RAM of the allocation.
+///
+/// Each generation is a bit-packed file (one bit per cell, rows padded to
+/// whole bytes) mapped into memory, and the two files swap roles every
+/// generation just like the buffers of an in-core Sector. A step streams
+/// the current file through a window of three unpacked row bands (the one
+/// being computed and the ones above and below it) and packs the results
+/// into the other file, so only 3 * band rows are ever expanded to bytes.
+/// The kernel is told to read ahead of the window and to start writing
+/// finished bands back right away.
+///
+/// The edge rows and columns of each generation are kept in memory as they
+/// are produced, so the halo exchange never has to read the files.
+struct OutOfCore {
+    int width;
+    int band;
+    long x0, y0;
+
+    size_t row_bytes;
+    size_t file_bytes;
+    std::string paths[2];
+    int files[2];
+    byte* bits[2];
+    int current;
+
+    /// Edges of each generation: the top and bottom rows and the west and
+    /// east columns, width cells each.
+    std::vector<byte> top[2], bottom[2], west[2], east[2];
+
+    /// Ghost cells from the neighbours. The ghost rows are width + 2 long
+    /// and include the corners.
+    std::vector<byte> ghost_north, ghost_south, ghost_west, ghost_east;
+
+    /// Three unpacked bands, stride width + 2, each with its ghost columns.
+    std::vector<byte> window[3];
+    std::vector<byte> out_row;
+};
+
+/// Creates the two generation files in dir and fills the current one with
+/// the same world sector_randomize would. Aborts the job if the files
+/// cannot be created or mapped.
+OutOfCore out_of_core_create(const std::string& dir, const Topology& topo, int width, int band,
+                             int density, unsigned seed);
+
+/// Unmaps and deletes the generation files; they are only scratch space.
+void out_of_core_free(OutOfCore& s);
+
+/// Exchanges edges with the neighbours and advances one generation.
+void out_of_core_step(OutOfCore& s, const Topology& topo);
+
+/// Live cells in the current generation.
+long out_of_core_population(const OutOfCore& s);
+
+#endif
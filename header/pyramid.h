@@ -0,0 +1,64 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <cstdint>
+#include <vector>
+
+#include "topology.h"
+#include "sector.h"
+
+/// ---------------------------------
+/// Population count mipmap of one sector.
+/// Cell (i, j) of level k counts the live cells in the 2^k x 2^k block of
+/// the sector whose top left corner is (i << k, j << k), clipped to the
+/// sector. Level 0 is the sector itself.
+///
+/// Only the levels from tile_shift up are stored; the finer ones are cheap
+/// to recount from the cells when asked for. Tiles (the cells of level
+/// tile_shift) are also the unit of change tracking: after a generation
+/// only the tiles whose cells changed are recounted, and only their
+/// ancestors are updated.
+struct Pyramid {
+    int width;
+    int tile_shift;
+    int levels;
+
+    /// Side length of each level, ceil(width / 2^k).
+    std::vector<int> sizes;
+
+    /// counts[k] and dirty[k] are row major sizes[k] x sizes[k] grids,
+    /// empty below tile_shift.
+    std::vector<std::vector<uint64_t>> counts;
+    std::vector<std::vector<byte>> dirty;
+};
+
+/// Builds the whole pyramid from the current generation of the sector.
+Pyramid pyramid_create(const Sector& s, int tile_shift = 3);
+
+/// Brings the pyramid up to date after a sector_swap, by comparing the
+/// current generation with the one before it.
+void pyramid_update(Pyramid& p, const Sector& s);
+
+/// Live cells of the sector in the local rectangle [x0, x1) x [y0, y1).
+uint64_t pyramid_count(const Pyramid& p, const Sector& s, int x0, int y0, int x1, int y1);
+
+/// ---------------------------------
+/// A window on the whole world at one zoom level. Cell (x, y) of the window
+/// is the global level `level` block (this->x + x, this->y + y), in other
+/// words it covers the 2^level x 2^level world cells starting at
+/// ((this->x + x) << level, (this->y + y) << level).
+struct Viewport {
+    int level;
+    long x, y;
+    int width, height;
+};
+
+/// Returns, on root, the live cell count of every cell of the viewport in row
+/// major order (empty on the other ranks). Only ranks whose sector overlaps
+/// the viewport send anything, and they send only the counts of the
+/// overlapping cells, so the traffic is proportional to the viewport and not
+/// the world. The viewport is taken from root. Collective over topo.comm;
+/// every rank must pass a sector of the same width.
+std::vector<uint64_t> query_viewport(const Topology& topo, const Sector& s, const Pyramid& p, Viewport view, int root);
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef SECTOR_H
+#define SECTOR_H
+
+#include <cstddef>
+
+// --------------------
+// Typedefs
+typedef unsigned char byte;
+
+struct Sector;
+
+/// A kernel computes the next generation of the cells in [x0, x1) x [y0, y1)
+/// of a sector into its other buffer. The available ones are listed in kernel.h.
+typedef void (*Kernel)(const Sector& s, int x0, int y0, int x1, int y1);
+
+/// ---------------------------------
+/// A sector is the square of the world owned by one rank, plus a one cell
+/// halo that mirrors the edges of the neighbouring sectors.
+/// Cells are stored row major with stride = width + 2, so cell (x, y) with
+/// x, y in [-1, width] lives at index (y + 1) * stride + (x + 1).
+/// There are two buffers so a generation can be computed from the previous
+/// one without overwriting it; cells[current] is the latest generation.
+struct Sector {
+    int width;
+    int stride;
+
+    /// Global coordinates of cell (0, 0), used to seed the world so that it
+    /// looks the same no matter how many ranks it is split over.
+    long x0, y0;
+
+    byte* cells[2];
+    int current;
+
+    /// How generations are computed, chosen at startup (see autotune.h):
+    /// kernel and its single thread form serial_kernel. tile is the side of
+    /// the cache blocks for kernels that use them.
+    Kernel kernel;
+    Kernel serial_kernel;
+    int tile;
+};
+
+/// Index of cell (x, y) in either buffer.
+inline size_t cell_index(const Sector& s, int x, int y) {
+    return (size_t)(y + 1) * s.stride + (x + 1);
+}
+
+/// Allocates both buffers. Pages are first touched (zeroed) from inside an
+/// OpenMP loop with the same static row schedule step_rows uses, so on a
+/// first-touch NUMA policy every row lands on the node of the thread that
+/// will update it. That holds exactly for the rows kernel and up to the
+/// band boundaries for the others (see kernel.cpp), and only for the thread
+/// count in effect at the call: create the sector after setting it.
+Sector sector_create(int width, long x0, long y0);
+void sector_free(Sector& s);
+
+/// Fills the current buffer with a random world in which each cell is alive
+/// with a 1 in density chance. The outcome depends only on the seed and the
+/// global position of each cell.
+void sector_randomize(Sector& s, int density, unsigned seed);
+
+/// The Game of Life rule for cells [x0, x1) of one row, given pointers to
+/// the row and the rows above and below it. Index -1 and x1 must be readable.
+inline void step_row(const byte* north, const byte* row, const byte* south, byte* out, int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        int neighbours = north[x - 1] + north[x] + north[x + 1]
+                       + row[x - 1]              + row[x + 1]
+                       + south[x - 1] + south[x] + south[x + 1];
+        out[x] = (neighbours == 3) | ((neighbours == 2) & row[x]);
+    }
+}
+
+/// Whether global cell (gx, gy) starts alive, for the given seed and density.
+byte initial_cell(unsigned seed, int density, long gx, long gy);
+
+/// Computes the next generation of the cells in [x0, x1) x [y0, y1) into the
+/// other buffer with the sector's kernel, without swapping. Only cells on
+/// the outer ring of the sector read the halo.
+inline void sector_step_region(const Sector& s, int x0, int y0, int x1, int y1) {
+    s.kernel(s, x0, y0, x1, y1);
+}
+
+/// The part of the sector that does not read the halo, and the ring that does.
+/// Together they cover every cell once, so the interior can be computed
+/// while the halo is still being exchanged.
+void sector_step_interior(const Sector& s);
+void sector_step_border(const Sector& s);
+
+/// Makes the buffer the steps above wrote into the current one.
+inline void sector_swap(Sector& s) {
+    s.current ^= 1;
+}
+
+/// Live cells in the current generation.
+long sector_population(const Sector& s);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <cstddef>
+#include "mpi.h"
+
+/// ---------------------------------
+/// The process grid.
+/// Ranks are arranged in a 2d cartesian communicator created with reorder
+/// enabled, so the MPI library is free to renumber ranks so that grid
+/// neighbours end up on the same node (and ideally the same socket).
+/// After topology_create, every rank should talk through `comm` and never
+/// through MPI_COMM_WORLD, since the ranks may not match.
+struct Topology {
+    MPI_Comm comm;
+    int rank, size;
+    int world_rank;
+
+    /// dims[0] is the number of rows of sectors, dims[1] the number of columns.
+    /// coords is this rank's (row, col) in that grid.
+    int dims[2];
+    int coords[2];
+
+    /// Ranks of the four edge neighbours and the four corner neighbours.
+    /// MPI_PROC_NULL at the edge of the world, which turns sends and
+    /// receives to that side into no-ops.
+    int north, south, west, east;
+    int north_west, north_east, south_west, south_east;
+};
+
+/// Builds the cartesian communicator out of every rank in parent.
+Topology topology_create(MPI_Comm parent);
+void topology_free(Topology& topo);
+
+/// Binds each OpenMP thread of this rank to its own processing unit inside
+/// the cpuset the launcher gave the rank. Needs hwloc (HAVE_HWLOC); without
+/// it this only tells the user that pinning is unavailable.
+///
+/// Call it once the thread count is final, and again whenever it changes:
+/// threads the runtime starts later copy the master's binding, which is a
+/// single unit after pinning, and would all share it.
+void pin_threads(const Topology& topo);
+
+/// Prints, on rank 0, where every rank ended up: host, grid position, the
+/// cores its threads run on, and the NUMA node(s) backing `memory`.
+/// Collective over topo.comm.
+void report_mapping(const Topology& topo, const void* memory, size_t bytes);
+
+#endif
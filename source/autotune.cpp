@@ -0,0 +1,190 @@
+// --------------------
+// Standard Library
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <fstream>
+#include <sstream>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+// --------------------
+// Library Includes
+#include "mpi.h"
+#include <omp.h>
+
+// --------------------
+// Project Includes
+#include "autotune.h"
+#include "kernel.h"
+
+namespace {
+
+/// Describes the machine and the problem; a cached tuning is only reused
+/// when this matches exactly. `threads` is the thread limit every rank agreed on.
+string cache_key(const Topology& topo, const Config& config, int threads) {
+    string cpu = "unknown cpu";
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (string line; std::getline(cpuinfo, line); )
+        if (line.compare(0, 10, "model name") == 0) {
+            cpu = line.substr(line.find(':') + 2);
+            break;
+        }
+
+    std::ostringstream key;
+    key << cpu
+        << "|cpus=" << omp_get_num_procs()
+        << "|threads=" << threads
+        << "|width=" << config.sector_width
+        << "|ranks=" << topo.size
+        << "|kernel=" << (config.kernel.empty() ? "*" : config.kernel)
+        << "|tile=" << config.tile
+        << "|fixed_threads=" << config.threads;
+    return key.str();
+}
+
+/// Looks key up in the cache file. Later lines win, so re-tuning just appends.
+bool read_cache(const string& path, const string& key, Tuning& tuning) {
+    std::ifstream in(path);
+    bool found = false;
+    for (string line; std::getline(in, line); ) {
+        size_t tab = line.find('\t');
+        if (tab == string::npos || line.compare(0, tab, key)) continue;
+
+        std::istringstream fields(line.substr(tab + 1));
+        string kernel;
+        Tuning t;
+        if (fields >> kernel >> t.tile >> t.threads && (t.kernel = find_kernel(kernel)) >= 0) {
+            tuning = t;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void write_cache(const string& path, const string& key, const Tuning& tuning) {
+    std::ofstream out(path, std::ios::app);
+    out << key << '\t' << kernels[tuning.kernel].name << ' ' << tuning.tile << ' ' << tuning.threads << '\n';
+}
+
+/// Every combination the tuner will try, honouring the fixed settings.
+/// Thread counts go up to `most`, which must be the same on every rank.
+vector<Tuning> candidates(const Config& config, const Tuning& fixed, int width, int most) {
+    vector<int> kernel_choices;
+    if (config.kernel.empty())
+        for (int k = 0; k < kernel_count; k++) kernel_choices.push_back(k);
+    else kernel_choices.push_back(fixed.kernel);
+
+    vector<int> thread_choices;
+    if (config.threads > 0) thread_choices.push_back(config.threads);
+    else {
+        for (int t = 1; t < most; t *= 2) thread_choices.push_back(t);
+        thread_choices.push_back(most);
+    }
+
+    vector<Tuning> list;
+    for (int k : kernel_choices) {
+        vector<int> tile_choices;
+        if (!kernels[k].tiled || config.tile > 0) tile_choices.push_back(fixed.tile);
+        else for (int t = 16; t <= 256 && (t == 16 || t < width); t *= 2) tile_choices.push_back(t);
+
+        for (int tile : tile_choices)
+            for (int threads : thread_choices)
+                list.push_back(Tuning{k, tile, threads});
+    }
+    return list;
+}
+
+void announce(const Topology& topo, const Tuning& t, const char* how) {
+    if (topo.rank != 0) return;
+    cout << "kernel " << kernels[t.kernel].name;
+    if (kernels[t.kernel].tiled) cout << ", tile " << t.tile;
+    cout << ", " << t.threads << " threads (" << how << ")" << endl;
+}
+
+}
+
+Tuning configured_tuning(const Config& config, int rank) {
+    Tuning tuning = {0, 64, omp_get_max_threads()};
+
+    if (!config.kernel.empty()) {
+        int k = find_kernel(config.kernel);
+        if (k >= 0) tuning.kernel = k;
+        else if (rank == 0) cout << "Unknown kernel " << config.kernel << ", using " << kernels[0].name << endl;
+    }
+    if (config.tile > 0) tuning.tile = config.tile;
+    if (config.threads > 0) tuning.threads = config.threads;
+    return tuning;
+}
+
+Tuning autotune(const Topology& topo, const Config& config, Sector& s) {
+    Tuning fixed = configured_tuning(config, topo.rank);
+
+    /// Ranks may have been given different thread limits; the candidate
+    /// list has to be the same everywhere, so tune within the smallest.
+    int most = omp_get_max_threads();
+    MPI_Allreduce(MPI_IN_PLACE, &most, 1, MPI_INT, MPI_MIN, topo.comm);
+    string key = cache_key(topo, config, most);
+
+    /// Rank 0 checks the cache and tells everyone whether to bother.
+    int found = 0;
+    Tuning tuning = fixed;
+    if (topo.rank == 0) found = read_cache(config.tune_cache, key, tuning);
+    MPI_Bcast(&found, 1, MPI_INT, 0, topo.comm);
+    MPI_Bcast(&tuning, sizeof(Tuning), MPI_BYTE, 0, topo.comm);
+
+    if (found) {
+        apply_tuning(tuning, s);
+        announce(topo, tuning, "cached");
+        return tuning;
+    }
+
+    /// Time each candidate. Every step recomputes the same next generation
+    /// from the current one, so the sector itself does not move.
+    vector<Tuning> list = candidates(config, fixed, s.width, most);
+    vector<double> times(list.size()), slowest(list.size());
+    for (size_t i = 0; i < list.size(); i++) {
+        apply_tuning(list[i], s);
+        sector_step_region(s, 0, 0, s.width, s.width);
+
+        double start = MPI_Wtime();
+        for (int g = 0; g < config.tune_generations; g++)
+            sector_step_region(s, 0, 0, s.width, s.width);
+        times[i] = MPI_Wtime() - start;
+    }
+
+    /// A generation is as slow as the slowest rank, so rank by that.
+    MPI_Allreduce(times.data(), slowest.data(), list.size(), MPI_DOUBLE, MPI_MAX, topo.comm);
+
+    size_t best = 0;
+    for (size_t i = 1; i < list.size(); i++)
+        if (slowest[i] < slowest[best]) best = i;
+    tuning = list[best];
+
+    /// How each kernel did with its own best settings.
+    if (topo.rank == 0) {
+        cout << "ms per generation:";
+        for (int k = 0; k < kernel_count; k++) {
+            double fastest = -1;
+            for (size_t i = 0; i < list.size(); i++)
+                if (list[i].kernel == k && (fastest < 0 || slowest[i] < fastest)) fastest = slowest[i];
+            if (fastest >= 0)
+                cout << " " << kernels[k].name << " " << 1000 * fastest / config.tune_generations;
+        }
+        cout << endl;
+    }
+
+    if (topo.rank == 0) write_cache(config.tune_cache, key, tuning);
+    apply_tuning(tuning, s);
+    announce(topo, tuning, "tuned");
+    return tuning;
+}
+
+void apply_tuning(const Tuning& tuning, Sector& s) {
+    s.kernel = kernels[tuning.kernel].step;
+    s.serial_kernel = kernels[tuning.kernel].serial;
+    s.tile = tuning.tile;
+    omp_set_num_threads(tuning.threads);
+}
@@ -0,0 +1,316 @@
+// --------------------
+// Standard Library
+#include <cstdio>
+#include <vector>
+using std::vector;
+#include <unordered_map>
+using std::unordered_map;
+#include <algorithm>
+using std::min;
+using std::max;
+#include <utility>
+using std::pair;
+#include <cstdint>
+
+// --------------------
+// Library Includes
+#include "mpi.h"
+
+// --------------------
+// Project Includes
+#include "census.h"
+#include "halo.h"
+
+namespace {
+
+/// Sizes are binned by powers of two: bin b holds sizes [2^b, 2^(b+1)).
+const int bins = 48;
+
+/// One object, or the part of one that lies in a single sector.
+struct Object {
+    int64_t label;
+    int64_t size;
+    int64_t x0, y0, x1, y1;     // inclusive bounding box, global coordinates
+};
+
+struct Link {
+    int64_t a, b;
+};
+
+void absorb(Object& into, const Object& part) {
+    into.size += part.size;
+    into.x0 = min(into.x0, part.x0);
+    into.y0 = min(into.y0, part.y0);
+    into.x1 = max(into.x1, part.x1);
+    into.y1 = max(into.y1, part.y1);
+}
+
+int bin_of(int64_t size) {
+    int b = 0;
+    while (b + 1 < bins && (int64_t(2) << b) <= size) b++;
+    return b;
+}
+
+/// Keeps only the `top` largest objects of list, largest first. Ties go by
+/// position, not label, since labels depend on how the world is split up.
+/// Objects that tie on everything print the same either way.
+void keep_largest(vector<Object>& list, int top) {
+    std::sort(list.begin(), list.end(), [](const Object& a, const Object& b) {
+        if (a.size != b.size) return a.size > b.size;
+        if (a.y0 != b.y0) return a.y0 < b.y0;
+        if (a.x0 != b.x0) return a.x0 < b.x0;
+        if (a.y1 != b.y1) return a.y1 < b.y1;
+        return a.x1 < b.x1;
+    });
+    if ((int) list.size() > top) list.resize(top);
+}
+
+int32_t find(vector<int32_t>& parent, int32_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void unite(vector<int32_t>& parent, int32_t a, int32_t b) {
+    a = find(parent, a);
+    b = find(parent, b);
+    if (a != b) parent[max(a, b)] = min(a, b);
+}
+
+/// Gathers a vector of plain structs of every rank onto rank 0.
+template <typename T>
+vector<T> gather(const vector<T>& mine, MPI_Comm comm, int rank, int size) {
+    int bytes = mine.size() * sizeof(T);
+    vector<int> counts(rank == 0 ? size : 0), displacements(rank == 0 ? size : 0);
+    MPI_Gather(&bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+
+    int total = 0;
+    for (int i = 0; i < (int) counts.size(); i++) {
+        displacements[i] = total;
+        total += counts[i];
+    }
+
+    vector<T> all(total / sizeof(T));
+    MPI_Gatherv(mine.data(), bytes, MPI_BYTE, all.data(), counts.data(), displacements.data(),
+        MPI_BYTE, 0, comm);
+    return all;
+}
+
+/// Sends the edge labels to the neighbours and receives theirs.
+void exchange_edges(Census& census, const Topology& topo) {
+    /// At the edge of the world nothing arrives, and the ghosts must read as dead.
+    for (vector<int64_t>* ghost : {&census.ghost_north, &census.ghost_south, &census.ghost_west, &census.ghost_east})
+        std::fill(ghost->begin(), ghost->end(), -1);
+
+    halo_exchange_edges(topo, census.width, MPI_INT64_T,
+        census.north.data(), census.south.data(), census.west.data(), census.east.data(),
+        census.ghost_north.data(), census.ghost_south.data(), census.ghost_west.data(), census.ghost_east.data());
+}
+
+}
+
+Census census_create(const Sector& s, int top) {
+    Census census;
+    census.width = s.width;
+    census.top = top;
+    for (vector<int64_t>* edge : {&census.north, &census.south, &census.west, &census.east})
+        edge->assign(s.width, -1);
+    census.ghost_north.assign(s.width + 2, -1);
+    census.ghost_south.assign(s.width + 2, -1);
+    census.ghost_west.assign(s.width, -1);
+    census.ghost_east.assign(s.width, -1);
+    return census;
+}
+
+void census_free(Census& census) {
+    census = Census();
+}
+
+void census_run(Census& census, const Topology& topo, const Sector& s, long generation) {
+    const int w = s.width;
+    const byte* cells = s.cells[s.current];
+
+    auto alive = [&](int x, int y) { return cells[cell_index(s, x, y)] != 0; };
+    auto at = [&](int x, int y) { return (int32_t)((size_t) y * w + x); };
+
+    /// ---------------------------------
+    /// Local union-find in raster order. Joining each live cell with the live
+    /// cells west, north-west, north and north-east of it covers every pair
+    /// of eight-neighbours exactly once. A parent always comes before its
+    /// children in raster order.
+    vector<int32_t> id((size_t) w * w);
+    for (int y = 0; y < w; y++)
+        for (int x = 0; x < w; x++) {
+            int32_t i = at(x, y);
+            id[i] = i;
+            if (!alive(x, y)) continue;
+            if (x > 0 && alive(x - 1, y)) unite(id, i, at(x - 1, y));
+            if (y > 0) {
+                if (x > 0 && alive(x - 1, y - 1)) unite(id, i, at(x - 1, y - 1));
+                if (alive(x, y - 1)) unite(id, i, at(x, y - 1));
+                if (x < w - 1 && alive(x + 1, y - 1)) unite(id, i, at(x + 1, y - 1));
+            }
+        }
+
+    /// Number the local objects and summarise each, overwriting the forest
+    /// with the numbers as it goes: a cell's parent has been numbered by the
+    /// time the cell is reached, and a root is the first cell of its object.
+    vector<Object> objects;
+    for (int y = 0; y < w; y++)
+        for (int x = 0; x < w; x++) {
+            int32_t i = at(x, y);
+            if (!alive(x, y)) {
+                id[i] = -1;
+                continue;
+            }
+            int64_t gx = s.x0 + x, gy = s.y0 + y;
+            if (id[i] == i) {
+                id[i] = objects.size();
+                objects.push_back(Object{0, 0, gx, gy, gx, gy});
+            }
+            else id[i] = id[id[i]];
+            absorb(objects[id[i]], Object{0, 1, gx, gy, gx, gy});
+        }
+
+    /// Labels unique across the world: offset by the objects of lower ranks.
+    int64_t count = objects.size(), offset = 0;
+    MPI_Exscan(&count, &offset, 1, MPI_INT64_T, MPI_SUM, topo.comm);
+    if (topo.rank == 0) offset = 0;
+
+    for (size_t i = 0; i < objects.size(); i++)
+        objects[i].label = offset + i;
+
+    auto own = [&](int x, int y) -> int64_t {
+        int32_t local = id[at(x, y)];
+        return local < 0 ? -1 : offset + local;
+    };
+    for (int i = 0; i < w; i++) {
+        census.north[i] = own(i, 0);
+        census.south[i] = own(i, w - 1);
+        census.west[i] = own(0, i);
+        census.east[i] = own(w - 1, i);
+    }
+
+    /// ---------------------------------
+    /// See the neighbours' labels, and record every pair of objects that
+    /// touch across the edge. Each touching pair of cells is seen from both
+    /// sides, so only look east, south, south-west and south-east.
+    exchange_edges(census, topo);
+
+    /// Label of any cell of the sector or of the ring around it.
+    auto label = [&](int x, int y) -> int64_t {
+        if (y < 0) return census.ghost_north[x + 1];
+        if (y >= w) return census.ghost_south[x + 1];
+        if (x < 0) return census.ghost_west[y];
+        if (x >= w) return census.ghost_east[y];
+        return own(x, y);
+    };
+    vector<Link> links;
+    auto link = [&](int64_t a, int64_t b) {
+        if (a >= 0 && b >= 0) links.push_back(Link{a, b});
+    };
+
+    for (int y = 0; y < w; y++) {
+        link(label(w - 1, y), label(w, y - 1));
+        link(label(w - 1, y), label(w, y));
+        link(label(w - 1, y), label(w, y + 1));
+    }
+    for (int x = 0; x < w; x++) {
+        link(label(x, w - 1), label(x - 1, w));
+        link(label(x, w - 1), label(x, w));
+        link(label(x, w - 1), label(x + 1, w));
+    }
+
+    std::sort(links.begin(), links.end(), [](const Link& p, const Link& q) {
+        return p.a != q.a ? p.a < q.a : p.b < q.b;
+    });
+    links.erase(std::unique(links.begin(), links.end(), [](const Link& p, const Link& q) {
+        return p.a == q.a && p.b == q.b;
+    }), links.end());
+
+    /// Objects that touch another sector go to rank 0 whole. The rest are
+    /// final already and only go as a histogram and a shortlist.
+    vector<byte> shared(objects.size(), 0);
+    auto mark = [&](int x, int y) {
+        int64_t a = own(x, y);
+        if (a < 0) return;
+        for (int dy = -1; dy <= 1; dy++)
+            for (int dx = -1; dx <= 1; dx++) {
+                int nx = x + dx, ny = y + dy;
+                if (nx >= 0 && nx < w && ny >= 0 && ny < w) continue;
+                if (label(nx, ny) >= 0) shared[a - offset] = 1;
+            }
+    };
+    for (int i = 0; i < w; i++) {
+        mark(i, 0);
+        mark(i, w - 1);
+        mark(0, i);
+        mark(w - 1, i);
+    }
+
+    vector<Object> boundary, largest;
+    vector<long> histogram(bins, 0);
+    for (size_t i = 0; i < objects.size(); i++) {
+        if (shared[i]) boundary.push_back(objects[i]);
+        else {
+            histogram[bin_of(objects[i].size)]++;
+            largest.push_back(objects[i]);
+        }
+    }
+    keep_largest(largest, census.top);
+
+    vector<long> total_histogram(bins, 0);
+    MPI_Reduce(histogram.data(), total_histogram.data(), bins, MPI_LONG, MPI_SUM, 0, topo.comm);
+    vector<Object> all_boundary = gather(boundary, topo.comm, topo.rank, topo.size);
+    vector<Link> all_links = gather(links, topo.comm, topo.rank, topo.size);
+    vector<Object> all_largest = gather(largest, topo.comm, topo.rank, topo.size);
+
+    if (topo.rank != 0) return;
+
+    /// ---------------------------------
+    /// Merge the pieces of objects that span sectors.
+    unordered_map<int64_t, int32_t> index;
+    for (size_t i = 0; i < all_boundary.size(); i++)
+        index[all_boundary[i].label] = i;
+
+    vector<int32_t> merged(all_boundary.size());
+    for (size_t i = 0; i < merged.size(); i++) merged[i] = i;
+    for (const Link& l : all_links)
+        unite(merged, index.at(l.a), index.at(l.b));
+
+    vector<Object> whole;
+    unordered_map<int32_t, int32_t> whole_of;
+    for (size_t i = 0; i < all_boundary.size(); i++) {
+        int32_t root = find(merged, i);
+        auto found = whole_of.find(root);
+        if (found == whole_of.end()) {
+            whole_of[root] = whole.size();
+            whole.push_back(all_boundary[i]);
+        }
+        else absorb(whole[found->second], all_boundary[i]);
+    }
+
+    for (const Object& o : whole) {
+        total_histogram[bin_of(o.size)]++;
+        all_largest.push_back(o);
+    }
+    keep_largest(all_largest, census.top);
+
+    long objects_total = 0;
+    for (long n : total_histogram) objects_total += n;
+
+    printf("census at generation %ld: %ld objects\n", generation, objects_total);
+    for (int b = 0; b < bins; b++) {
+        if (!total_histogram[b]) continue;
+        char range[48];
+        if (b == 0) snprintf(range, sizeof(range), "1");
+        else snprintf(range, sizeof(range), "%lld-%lld", 1ll << b, (2ll << b) - 1);
+        printf("  size %15s: %ld\n", range, total_histogram[b]);
+    }
+    for (const Object& o : all_largest)
+        printf("  %lld cells in (%lld, %lld) - (%lld, %lld)\n", (long long) o.size,
+            (long long) o.x0, (long long) o.y0, (long long) o.x1, (long long) o.y1);
+    fflush(stdout);
+}
@@ -0,0 +1,84 @@
+// --------------------
+// Standard Library
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+// --------------------
+// Project Includes
+#include "config.h"
+
+Config parse_args(int argc, char* argv[], int rank) {
+    Config config;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        /// Flags that take a value consume the next argument.
+        if (value && !strcmp(arg, "--width"))        { config.sector_width = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--runtime")) { config.runtime = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--density")) { config.density = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--seed"))    { config.seed = strtoul(value, nullptr, 10); i++; }
+        else if (value && !strcmp(arg, "--progress")) { config.progress = atof(value); i++; }
+        else if (value && !strcmp(arg, "--view"))    { config.view_every = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--columns")) { config.view_columns = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--log"))      { config.log_dir = value; i++; }
+        else if (value && !strcmp(arg, "--keyframe")) { config.keyframe_every = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--output"))   { config.replay_output = value; i++; }
+        else if (value && !strcmp(arg, "--out-of-core")) { config.out_of_core_dir = value; i++; }
+        else if (value && !strcmp(arg, "--band"))        { config.band = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--kernel"))      { config.kernel = value; i++; }
+        else if (value && !strcmp(arg, "--tile"))        { config.tile = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--threads"))     { config.threads = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--tune-cache"))  { config.tune_cache = value; i++; }
+        else if (value && !strcmp(arg, "--tune-generations")) { config.tune_generations = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--census"))      { config.census_every = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--census-top"))  { config.census_top = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--worlds"))      { config.worlds = atol(value); i++; }
+        else if (value && !strcmp(arg, "--ensemble-width")) { config.ensemble_width = atoi(value); i++; }
+        else if (value && !strcmp(arg, "--ensemble-output")) { config.ensemble_output = value; i++; }
+        else if (value && !strcmp(arg, "--densities")) {
+            /// A comma separated list, such as 3,4,6,8.
+            for (const char* at = value; *at; ) {
+                int density = atoi(at);
+                if (density > 0) config.densities.push_back(density);
+                at = strchr(at, ',');
+                if (!at) break;
+                at++;
+            }
+            i++;
+        }
+        else if (value && i + 2 < argc && !strcmp(arg, "--replay")) {
+            config.replay_dir = value;
+            config.replay_generation = atol(argv[i + 2]);
+            i += 2;
+        }
+        else if (!strcmp(arg, "--pin"))              config.pin = true;
+        else if (!strcmp(arg, "--autotune"))         config.tune = true;
+        else if (!strcmp(arg, "--ensemble"))         config.ensemble = true;
+        else if (!strcmp(arg, "--dataflow"))         config.dataflow = true;
+        else if (!strcmp(arg, "--quiet"))            config.report = false;
+        else if (rank == 0)
+            cout << "Ignoring unknown argument: " << arg << endl;
+    }
+
+    if (config.sector_width < 1) config.sector_width = 1;
+    if (config.density < 1) config.density = 1;
+    if (config.view_columns < 2) config.view_columns = 2;
+    if (config.band < 1) config.band = 1;
+    if (config.tune_generations < 1) config.tune_generations = 1;
+    if (config.census_top < 0) config.census_top = 0;
+    if (config.census_every > 0 && (int64_t) config.sector_width * config.sector_width > INT32_MAX) {
+        if (rank == 0) cout << "--census supports sectors up to 46340 cells wide, ignoring it" << endl;
+        config.census_every = 0;
+    }
+    if (config.ensemble_width < 1) config.ensemble_width = 1;
+    if (config.worlds < 0) config.worlds = 0;
+    if (config.densities.empty()) config.densities.push_back(config.density);
+
+    return config;
+}
@@ -0,0 +1,83 @@
+// --------------------
+// Standard Library
+#include <vector>
+using std::vector;
+#include <algorithm>
+using std::min;
+using std::max;
+
+// --------------------
+// Library Includes
+#include "mpi.h"
+#include <omp.h>
+
+// --------------------
+// Project Includes
+#include "dataflow.h"
+
+void dataflow_run(Sector& s, Halo halo[2], int generations) {
+    const int w = s.width, t = max(1, min(s.tile, w));
+    const int tiles = (w + t - 1) / t;
+    const int start = s.current;
+
+    /// Dependency tokens. Their contents are never used, only their addresses:
+    /// token[b][j * tiles + i] stands for tile (i, j) of buffer b, and
+    /// exchanged[b] for the halo of buffer b.
+    vector<char> token[2] = {vector<char>(tiles * tiles), vector<char>(tiles * tiles)};
+    char exchanged[2];
+    char no_halo;
+
+    /// The tiles the halo exchange reads from, in any order.
+    vector<int> ring;
+    for (int j = 0; j < tiles; j++)
+        for (int i = 0; i < tiles; i++)
+            if (i == 0 || j == 0 || i == tiles - 1 || j == tiles - 1)
+                ring.push_back(j * tiles + i);
+    const int ring_count = ring.size();
+    const int* ring_tiles = ring.data();
+
+    #pragma omp parallel
+    #pragma omp single
+    for (int g = 0; g < generations; g++) {
+        const int from = (start + g) % 2, to = from ^ 1;
+        [[maybe_unused]] char* before = token[from].data();
+        [[maybe_unused]] char* after = token[to].data();
+
+        /// Halo of generation g, once its border tiles exist. The task does
+        /// not block in MPI: it polls, yielding to ready tiles in between.
+        Halo* exchange = &halo[from];
+        #pragma omp task firstprivate(exchange) depend(iterator(k = 0 : ring_count), in : before[ring_tiles[k]]) depend(out : exchanged[from])
+        {
+            halo_start(*exchange);
+            while (!halo_test(*exchange)) {
+                #pragma omp taskyield
+            }
+        }
+
+        Sector view = s;
+        view.current = from;
+
+        /// Every tile of generation g + 1. The tasks already spread the work
+        /// over the threads, so each one runs the serial form of the kernel.
+        for (int j = 0; j < tiles; j++)
+            for (int i = 0; i < tiles; i++) {
+                int west = max(i - 1, 0), east = min(i + 1, tiles - 1);
+                int north = max(j - 1, 0), south = min(j + 1, tiles - 1);
+                bool border = i == 0 || j == 0 || i == tiles - 1 || j == tiles - 1;
+                [[maybe_unused]] char* halo_dependency = border ? &exchanged[from] : &no_halo;
+
+                #pragma omp task firstprivate(view, i, j) \
+                    depend(in : before[north * tiles + west], before[north * tiles + i], before[north * tiles + east], \
+                                before[j * tiles + west],     before[j * tiles + i],     before[j * tiles + east], \
+                                before[south * tiles + west], before[south * tiles + i], before[south * tiles + east], \
+                                halo_dependency[0]) \
+                    depend(out : after[j * tiles + i])
+                {
+                    int x0 = i * t, y0 = j * t;
+                    view.serial_kernel(view, x0, y0, min(x0 + t, w), min(y0 + t, w));
+                }
+            }
+    }
+
+    s.current = (start + generations) % 2;
+}
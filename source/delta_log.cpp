@@ -0,0 +1,417 @@
+// --------------------
+// Standard Library
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+
+// used for mkdir
+#include <sys/stat.h>
+
+// --------------------
+// Library Includes
+#include "mpi.h"
+
+// --------------------
+// Project Includes
+#include "delta_log.h"
+
+namespace {
+
+const char magic[8] = {'G', 'O', 'L', 'D', 'E', 'L', 'T', 'A'};
+const uint32_t version = 2;
+
+enum RecordType : uint8_t { KEYFRAME = 'K', DELTA = 'D' };
+
+/// Every file of one run carries the same run id, rank count, grid and
+/// world size, so replay can tell the files of a run from leftovers of
+/// another one in the same directory.
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    int64_t x0, y0;
+    uint32_t keyframe_every;
+    uint32_t rank;
+    uint64_t run;
+    uint32_t ranks;
+    uint32_t dims[2];
+    uint32_t unused;
+    int64_t world_width, world_height;
+};
+
+struct RecordHeader {
+    uint8_t type;
+    uint8_t rice;           // Golomb-Rice parameter, log2 of the divisor
+    uint8_t unused[6];
+    uint64_t generation;
+    uint64_t flips;         // number of gaps in the payload
+    uint64_t bytes;         // payload size
+};
+
+/// ---------------------------------
+/// Bit streams, least significant bit first.
+
+struct BitWriter {
+    vector<byte>& out;
+    uint64_t acc = 0;
+    int used = 0;
+
+    /// Appends the low `bits` bits of value, 0 <= bits <= 64.
+    void put(uint64_t value, int bits) {
+        if (bits == 0) return;
+        if (bits < 64) value &= (1ull << bits) - 1;
+
+        acc |= value << used;
+        int room = 64 - used;
+        if (bits < room) {
+            used += bits;
+            return;
+        }
+
+        /// The word is full; carry whatever did not fit into the next one.
+        flush_word();
+        if (room < 64) acc = value >> room;
+        used = bits - room;
+    }
+
+    /// q ones then a zero.
+    void unary(uint64_t q) {
+        while (q >= 32) { put(0xffffffffull, 32); q -= 32; }
+        put((1ull << q) - 1, q + 1);
+    }
+
+    void rice(uint64_t value, int k) {
+        unary(value >> k);
+        put(value, k);
+    }
+
+    void flush_word() {
+        for (int i = 0; i < 8; i++) out.push_back(acc >> (8 * i));
+        acc = 0;
+        used = 0;
+    }
+
+    void finish() {
+        for (int i = 0; i < used; i += 8) out.push_back(acc >> i);
+        acc = 0;
+        used = 0;
+    }
+};
+
+/// Reading past the end gives zeros and sets overrun.
+struct BitReader {
+    const vector<byte>& in;
+    size_t bit = 0;
+    bool overrun = false;
+
+    int next() {
+        if (bit >= in.size() * 8) {
+            overrun = true;
+            return 0;
+        }
+        int b = (in[bit >> 3] >> (bit & 7)) & 1;
+        bit++;
+        return b;
+    }
+
+    uint64_t get(int bits) {
+        uint64_t value = 0;
+        for (int i = 0; i < bits; i++) value |= (uint64_t) next() << i;
+        return value;
+    }
+
+    /// Quotients too large for any sector come back as UINT64_MAX.
+    uint64_t rice(int k) {
+        uint64_t q = 0;
+        while (next()) q++;
+        if (q >> (63 - k)) return UINT64_MAX;
+        return (q << k) | get(k);
+    }
+};
+
+/// Best Rice parameter for a geometric source with this mean: about log2(mean).
+int rice_parameter(uint64_t cells, uint64_t flips) {
+    if (flips == 0) return 0;
+    uint64_t mean = (cells - flips) / flips;
+    int k = 0;
+    while (k < 62 && (2ull << k) <= mean) k++;
+    return k;
+}
+
+/// Reads the next 8 cells of row as one word.
+inline uint64_t word(const byte* row) {
+    uint64_t w;
+    memcpy(&w, row, sizeof(w));
+    return w;
+}
+
+/// Calls visit(position) for every cell that differs between now and before
+/// (before == nullptr meaning an empty sector), in row major order.
+template <typename Visit>
+void each_flip(const Sector& s, const byte* now, const byte* before, Visit visit) {
+    const int w = s.width;
+    for (int y = 0; y < w; y++) {
+        const byte* a = now + cell_index(s, 0, y);
+        const byte* b = before ? before + cell_index(s, 0, y) : nullptr;
+        uint64_t base = (uint64_t) y * w;
+
+        int x = 0;
+        /// Skip unchanged runs eight cells at a time.
+        for (; x + 8 <= w; x += 8) {
+            if (word(a + x) == (b ? word(b + x) : 0)) continue;
+            for (int i = x; i < x + 8; i++)
+                if (a[i] != (b ? b[i] : 0)) visit(base + i);
+        }
+        for (; x < w; x++)
+            if (a[x] != (b ? b[x] : 0)) visit(base + x);
+    }
+}
+
+void write_record(DeltaLog& log, const Sector& s, long generation, bool keyframe) {
+    const byte* now = s.cells[s.current];
+    const byte* before = keyframe ? nullptr : s.cells[s.current ^ 1];
+    const uint64_t cells = (uint64_t) s.width * s.width;
+
+    uint64_t flips = 0;
+    each_flip(s, now, before, [&](uint64_t) { flips++; });
+
+    RecordHeader record;
+    memset(&record, 0, sizeof(record));
+    record.type = keyframe ? KEYFRAME : DELTA;
+    record.rice = rice_parameter(cells, flips);
+    record.generation = generation;
+    record.flips = flips;
+
+    log.bits.clear();
+    BitWriter writer{log.bits};
+    uint64_t last = 0;
+    each_flip(s, now, before, [&](uint64_t position) {
+        writer.rice(position - last, record.rice);
+        last = position + 1;
+    });
+    writer.finish();
+    record.bytes = log.bits.size();
+
+    fwrite(&record, sizeof(record), 1, log.file);
+    fwrite(log.bits.data(), 1, log.bits.size(), log.file);
+}
+
+/// One rank's log during replay.
+struct SectorLog {
+    FileHeader header;
+    vector<byte> cells;
+};
+
+/// replay_file's result for a log that is damaged rather than short.
+const long corrupt = -2;
+
+/// Replays one log up to `generation` into log.cells. Returns the generation
+/// actually reached, which is lower if the log ends early, or corrupt if a
+/// record does not fit the sector or the file.
+long replay_file(FILE* file, SectorLog& log, long generation) {
+    RecordHeader record;
+    const uint64_t cells = log.cells.size();
+
+    fseek(file, 0, SEEK_END);
+    const uint64_t file_bytes = ftell(file);
+    fseek(file, sizeof(FileHeader), SEEK_SET);
+
+    /// First pass: find the last keyframe at or before the target.
+    long keyframe_at = -1;
+    while (fread(&record, sizeof(record), 1, file) == 1 && (long) record.generation <= generation) {
+        if (record.bytes > file_bytes - ftell(file)) break;
+        if (record.type == KEYFRAME) keyframe_at = ftell(file) - sizeof(record);
+        fseek(file, record.bytes, SEEK_CUR);
+    }
+    if (keyframe_at < 0) return -1;
+
+    /// Second pass: apply it and every delta after it.
+    fseek(file, keyframe_at, SEEK_SET);
+    long reached = -1;
+    vector<byte> payload;
+    while (fread(&record, sizeof(record), 1, file) == 1 && (long) record.generation <= generation) {
+        if (record.bytes > file_bytes - ftell(file)) break;
+        payload.resize(record.bytes);
+        if (fread(payload.data(), 1, record.bytes, file) != record.bytes) break;
+
+        if (record.rice > 62 || record.flips > cells) return corrupt;
+        if (record.type == KEYFRAME) std::fill(log.cells.begin(), log.cells.end(), 0);
+
+        BitReader reader{payload};
+        uint64_t position = 0;
+        for (uint64_t i = 0; i < record.flips; i++) {
+            uint64_t gap = reader.rice(record.rice);
+            if (reader.overrun || gap >= cells - position) return corrupt;
+            position += gap;
+            log.cells[position] ^= 1;
+            position++;
+        }
+        reached = record.generation;
+    }
+    return reached;
+}
+
+/// Opens one rank's log and checks its header. Returns nullptr, after
+/// saying why, if it is missing or not a delta log.
+FILE* open_log(const string& path, FileHeader& header) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        cout << "Could not open " << path << endl;
+        return nullptr;
+    }
+    if (fread(&header, sizeof(FileHeader), 1, file) != 1 ||
+        memcmp(header.magic, magic, sizeof(magic)) || header.version != version) {
+        cout << path << " is not a delta log of this version" << endl;
+        fclose(file);
+        return nullptr;
+    }
+    return file;
+}
+
+}
+
+DeltaLog delta_log_open(const string& dir, const Topology& topo, const Sector& s, int keyframe_every) {
+    DeltaLog log;
+    log.keyframe_every = keyframe_every;
+
+    /// Rank 0 names the run. Collective, so before anything can fail.
+    uint64_t run = 0;
+    if (topo.rank == 0)
+        run = std::chrono::system_clock::now().time_since_epoch().count();
+    MPI_Bcast(&run, 1, MPI_UINT64_T, 0, topo.comm);
+
+    mkdir(dir.c_str(), 0755);
+    string path = dir + "/rank_" + std::to_string(topo.rank) + ".gol";
+    log.file = fopen(path.c_str(), "wb");
+    if (!log.file) {
+        cout << "Rank " << topo.rank << " could not open " << path << ", not logging" << endl;
+        return log;
+    }
+
+    /// Large buffer so records are written in big sequential chunks.
+    setvbuf(log.file, nullptr, _IOFBF, 1 << 20);
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.width = s.width;
+    header.x0 = s.x0;
+    header.y0 = s.y0;
+    header.keyframe_every = keyframe_every;
+    header.rank = topo.rank;
+    header.run = run;
+    header.ranks = topo.size;
+    header.dims[0] = topo.dims[0];
+    header.dims[1] = topo.dims[1];
+    header.world_width = (int64_t) topo.dims[1] * s.width;
+    header.world_height = (int64_t) topo.dims[0] * s.width;
+    fwrite(&header, sizeof(header), 1, log.file);
+
+    write_record(log, s, 0, true);
+    return log;
+}
+
+void delta_log_close(DeltaLog& log) {
+    if (log.file) fclose(log.file);
+    log.file = nullptr;
+}
+
+void delta_log_record(DeltaLog& log, const Sector& s, long generation) {
+    if (!log.file) return;
+    write_record(log, s, generation, log.keyframe_every > 0 && generation % log.keyframe_every == 0);
+}
+
+bool delta_log_replay(const string& dir, long generation, const string& output) {
+    auto path_of = [&](uint32_t rank) { return dir + "/rank_" + std::to_string(rank) + ".gol"; };
+
+    /// Rank 0's log says which run this is and how many logs belong to it.
+    /// Other files in dir, such as the logs of a bigger earlier run, are ignored.
+    FileHeader run;
+    FILE* first = open_log(path_of(0), run);
+    if (!first) return false;
+    fclose(first);
+
+    const long world_width = run.world_width, world_height = run.world_height;
+    const uint32_t across = run.dims[1], down = run.dims[0];
+    if (run.ranks == 0 || (uint64_t) across * down != run.ranks ||
+        world_width != (int64_t) across * run.width || world_height != (int64_t) down * run.width) {
+        cout << path_of(0) << " describes an inconsistent process grid" << endl;
+        return false;
+    }
+
+    /// Each grid position must be covered by exactly one log, so together
+    /// they tile the world once.
+    vector<SectorLog> logs(run.ranks);
+    vector<byte> covered(run.ranks, 0);
+    for (uint32_t r = 0; r < run.ranks; r++) {
+        string path = path_of(r);
+        SectorLog& log = logs[r];
+        FILE* file = open_log(path, log.header);
+        if (!file) return false;
+
+        const FileHeader& h = log.header;
+        if (h.run != run.run || h.rank != r || h.ranks != run.ranks || h.width != run.width ||
+            h.dims[0] != down || h.dims[1] != across) {
+            cout << path << " belongs to a different run than " << path_of(0) << endl;
+            fclose(file);
+            return false;
+        }
+
+        long col = h.x0 / h.width, row = h.y0 / h.width;
+        if (h.x0 < 0 || h.y0 < 0 || h.x0 % h.width || h.y0 % h.width || col >= across || row >= down ||
+            covered[row * across + col]++) {
+            cout << path << " does not fit the process grid of its run" << endl;
+            fclose(file);
+            return false;
+        }
+
+        log.cells.assign((size_t) h.width * h.width, 0);
+        long reached = replay_file(file, log, generation);
+        fclose(file);
+
+        if (reached == corrupt) {
+            cout << path << " is corrupt" << endl;
+            return false;
+        }
+        if (reached != generation) {
+            cout << path << " does not reach generation " << generation << endl;
+            return false;
+        }
+    }
+
+    /// Binary PBM: rows padded to whole bytes, most significant bit first, 1 is black (alive).
+    long row_bytes = (world_width + 7) / 8;
+    vector<byte> image(row_bytes * world_height, 0);
+    for (const SectorLog& log : logs) {
+        long w = log.header.width;
+        for (long y = 0; y < w; y++)
+            for (long x = 0; x < w; x++)
+                if (log.cells[y * w + x]) {
+                    long gx = log.header.x0 + x, gy = log.header.y0 + y;
+                    image[gy * row_bytes + gx / 8] |= 0x80 >> (gx % 8);
+                }
+    }
+
+    FILE* out = fopen(output.c_str(), "wb");
+    if (!out) {
+        cout << "Could not write " << output << endl;
+        return false;
+    }
+    fprintf(out, "P4\n%ld %ld\n", world_width, world_height);
+    fwrite(image.data(), 1, image.size(), out);
+    fclose(out);
+
+    cout << "Wrote generation " << generation << " (" << world_width << "x" << world_height
+         << ", " << logs.size() << " sectors) to " << output << endl;
+    return true;
+}
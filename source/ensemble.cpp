@@ -0,0 +1,292 @@
+// --------------------
+// Standard Library
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <vector>
+using std::vector;
+#include <map>
+using std::map;
+#include <algorithm>
+using std::min;
+#include <cstdio>
+#include <cstdint>
+
+// --------------------
+// Library Includes
+#include "mpi.h"
+#include <omp.h>
+
+// --------------------
+// Project Includes
+#include "ensemble.h"
+#include "sector.h"
+
+namespace {
+
+const int TAG_REQUEST = 200;
+const int TAG_RESULTS = 201;
+const int TAG_ASSIGN = 202;
+
+const int lanes = 64;
+
+int density_of(const Config& config, long world) {
+    return config.densities[world % config.densities.size()];
+}
+
+/// Adds one neighbour word into the three bit per lane counter (s2 s1 s0).
+/// Eight neighbours wrap to zero, which is fine: eight means dead either way.
+inline void add(uint64_t a, uint64_t& s0, uint64_t& s1, uint64_t& s2) {
+    uint64_t c0 = s0 & a;
+    s0 ^= a;
+    uint64_t c1 = s1 & c0;
+    s1 ^= c0;
+    s2 ^= c1;
+}
+
+/// Live cells of every lane in `lanes_wanted` of grid g.
+void lane_population(const vector<uint64_t>& g, uint64_t lanes_wanted, int32_t* population) {
+    for (uint64_t cell : g) {
+        uint64_t live = cell & lanes_wanted;
+        while (live) {
+            population[__builtin_ctzll(live)]++;
+            live &= live - 1;
+        }
+    }
+}
+
+/// Prints the summary per density, and every world to config.ensemble_output if set.
+void print_summary(const Config& config, const vector<WorldResult>& all) {
+    struct Stats {
+        long worlds = 0, died = 0, still = 0, oscillating = 0, active = 0;
+        double population = 0, generation = 0;
+    };
+    map<int, Stats> by_density;
+    for (const WorldResult& r : all) {
+        Stats& s = by_density[r.density];
+        s.worlds++;
+        s.population += r.population;
+        s.generation += r.generation;
+        if (r.outcome == OUTCOME_DIED) s.died++;
+        else if (r.outcome == OUTCOME_STILL) s.still++;
+        else if (r.outcome == OUTCOME_OSCILLATOR) s.oscillating++;
+        else s.active++;
+    }
+
+    cout << all.size() << " worlds of " << config.ensemble_width << "x" << config.ensemble_width
+         << ", up to " << config.runtime << " generations" << endl;
+    printf("%8s %8s %8s %8s %8s %8s %12s %12s\n",
+        "density", "worlds", "died", "still", "period2", "active", "mean pop", "mean gen");
+    for (const auto& entry : by_density) {
+        const Stats& s = entry.second;
+        char density[16];
+        snprintf(density, sizeof(density), "1/%d", entry.first);
+        printf("%8s %8ld %8ld %8ld %8ld %8ld %12.1f %12.1f\n", density, s.worlds, s.died, s.still,
+            s.oscillating, s.active, s.population / s.worlds, s.generation / s.worlds);
+    }
+    fflush(stdout);
+
+    if (!config.ensemble_output.empty()) {
+        FILE* out = fopen(config.ensemble_output.c_str(), "w");
+        if (!out) {
+            cout << "Could not write " << config.ensemble_output << endl;
+            return;
+        }
+        const char* names[] = {"died", "still", "period2", "active"};
+        fprintf(out, "world,density,generation,population,outcome\n");
+        for (const WorldResult& r : all)
+            fprintf(out, "%ld,%d,%d,%d,%s\n", (long) r.world, r.density, r.generation, r.population, names[r.outcome]);
+        fclose(out);
+    }
+}
+
+/// Runs worlds [first, first + count) as batches of 64, one batch per thread.
+void run_range(const Config& config, long first, long count, vector<WorldResult>& results) {
+    long batches = (count + lanes - 1) / lanes;
+    vector<vector<WorldResult>> per_batch(batches);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (long b = 0; b < batches; b++)
+        run_batch(config, first + b * lanes, (int) min((long) lanes, count - b * lanes), per_batch[b]);
+
+    for (const vector<WorldResult>& batch : per_batch)
+        results.insert(results.end(), batch.begin(), batch.end());
+}
+
+/// Answers one request from `worker`: collects the results of its last
+/// range and hands it the next one, or an empty range once all are out.
+void serve(const Config& config, MPI_Comm comm, int worker, long& next, int& working, vector<WorldResult>& all) {
+    long capacity;
+    MPI_Recv(&capacity, 1, MPI_LONG, worker, TAG_REQUEST, comm, MPI_STATUS_IGNORE);
+
+    /// The request is followed by the results of the worker's last range.
+    MPI_Status status;
+    int bytes;
+    MPI_Probe(worker, TAG_RESULTS, comm, &status);
+    MPI_Get_count(&status, MPI_BYTE, &bytes);
+    vector<WorldResult> incoming(bytes / sizeof(WorldResult));
+    MPI_Recv(incoming.data(), bytes, MPI_BYTE, worker, TAG_RESULTS, comm, MPI_STATUS_IGNORE);
+    all.insert(all.end(), incoming.begin(), incoming.end());
+
+    long range[2] = {next, min(capacity, config.worlds - next)};
+    next += range[1];
+    if (range[1] == 0) working--;
+    MPI_Send(range, 2, MPI_LONG, worker, TAG_ASSIGN, comm);
+}
+
+/// Rank 0 with helpers: answer whatever requests are waiting, then run a
+/// batch per thread of its own, until every worker has been told to stop.
+/// Its own share is kept to one batch per thread so a request never waits
+/// longer than a batch takes.
+void master(const Config& config, MPI_Comm comm, int size, vector<WorldResult>& all) {
+    long next = 0;
+    int working = size - 1;
+    const long share = (long) lanes * omp_get_max_threads();
+
+    while (working > 0) {
+        MPI_Status status;
+        int waiting = 1;
+        if (next < config.worlds) MPI_Iprobe(MPI_ANY_SOURCE, TAG_REQUEST, comm, &waiting, &status);
+        else MPI_Probe(MPI_ANY_SOURCE, TAG_REQUEST, comm, &status);
+
+        if (waiting) {
+            serve(config, comm, status.MPI_SOURCE, next, working, all);
+        }
+        else {
+            long count = min(share, config.worlds - next);
+            run_range(config, next, count, all);
+            next += count;
+        }
+    }
+}
+
+/// Everyone else: ask for a range big enough to give every thread a batch,
+/// run it, send the results back with the next request.
+void worker(const Config& config, MPI_Comm comm) {
+    long capacity = (long) lanes * omp_get_max_threads();
+    vector<WorldResult> results;
+
+    while (true) {
+        MPI_Send(&capacity, 1, MPI_LONG, 0, TAG_REQUEST, comm);
+        MPI_Send(results.data(), results.size() * sizeof(WorldResult), MPI_BYTE, 0, TAG_RESULTS, comm);
+
+        long range[2];
+        MPI_Recv(range, 2, MPI_LONG, 0, TAG_ASSIGN, comm, MPI_STATUS_IGNORE);
+        if (range[1] == 0) break;
+
+        results.clear();
+        run_range(config, range[0], range[1], results);
+    }
+}
+
+}
+
+void run_batch(const Config& config, long first, int count, vector<WorldResult>& results) {
+    const int n = config.ensemble_width, stride = n + 2;
+
+    /// prev, cur and next generations, each with a ring of dead cells.
+    vector<uint64_t> grid[3];
+    for (vector<uint64_t>& g : grid) g.assign((size_t) stride * stride, 0);
+    int prev = 0, cur = 1, next = 2;
+
+    for (int i = 0; i < count; i++) {
+        long world = first + i;
+        int density = density_of(config, world);
+        unsigned seed = config.seed + (unsigned) world;
+        for (int y = 0; y < n; y++)
+            for (int x = 0; x < n; x++)
+                grid[cur][(size_t)(y + 1) * stride + x + 1] |= (uint64_t) initial_cell(seed, density, x, y) << i;
+    }
+
+    uint64_t active = count == lanes ? ~0ull : (1ull << count) - 1;
+    int32_t population[lanes] = {0};
+    int32_t generation[lanes] = {0};
+    int32_t outcome[lanes];
+    for (int i = 0; i < lanes; i++) outcome[i] = OUTCOME_ACTIVE;
+
+    /// Marks the lanes in `done` as finished with the given outcome at generation g.
+    auto finish = [&](uint64_t done, Outcome why, int g, const vector<uint64_t>& state) {
+        if (!done) return;
+        lane_population(state, done, population);
+        for (uint64_t bits = done; bits; bits &= bits - 1) {
+            int lane = __builtin_ctzll(bits);
+            generation[lane] = g;
+            outcome[lane] = why;
+        }
+        active &= ~done;
+    };
+
+    /// A world that starts empty is already done.
+    uint64_t alive = 0;
+    for (uint64_t cell : grid[cur]) alive |= cell;
+    finish(active & ~alive, OUTCOME_DIED, 0, grid[cur]);
+
+    int g = 0;
+    while (active && g < config.runtime) {
+        const uint64_t* src = grid[cur].data();
+        const uint64_t* old = grid[prev].data();
+        uint64_t* dst = grid[next].data();
+
+        uint64_t changed = 0, changed_since_prev = 0;
+        alive = 0;
+
+        for (int y = 1; y <= n; y++) {
+            const uint64_t* north = src + (size_t)(y - 1) * stride;
+            const uint64_t* row = north + stride;
+            const uint64_t* south = row + stride;
+            for (int x = 1; x <= n; x++) {
+                uint64_t s0 = 0, s1 = 0, s2 = 0;
+                add(north[x - 1], s0, s1, s2); add(north[x], s0, s1, s2); add(north[x + 1], s0, s1, s2);
+                add(row[x - 1], s0, s1, s2);                              add(row[x + 1], s0, s1, s2);
+                add(south[x - 1], s0, s1, s2); add(south[x], s0, s1, s2); add(south[x + 1], s0, s1, s2);
+
+                /// Alive with 3 neighbours (011), or with 2 (010) if alive already.
+                uint64_t cell = s1 & ~s2 & (s0 | row[x]);
+                size_t at = (size_t) y * stride + x;
+                dst[at] = cell;
+                changed |= cell ^ row[x];
+                changed_since_prev |= cell ^ old[at];
+                alive |= cell;
+            }
+        }
+
+        g++;
+        std::swap(prev, cur);
+        std::swap(cur, next);
+
+        uint64_t died = active & ~alive;
+        uint64_t still = active & alive & ~changed;
+        uint64_t oscillating = active & alive & changed & ~changed_since_prev;
+        finish(died, OUTCOME_DIED, g, grid[cur]);
+        finish(still, OUTCOME_STILL, g, grid[cur]);
+        finish(oscillating, OUTCOME_OSCILLATOR, g, grid[cur]);
+    }
+
+    /// Whatever is left ran out of time.
+    finish(active, OUTCOME_ACTIVE, g, grid[cur]);
+
+    for (int i = 0; i < count; i++)
+        results.push_back(WorldResult{first + i, density_of(config, first + i),
+            generation[i], population[i], outcome[i]});
+}
+
+void run_ensemble(const Config& config, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    double start = MPI_Wtime();
+    vector<WorldResult> all;
+
+    if (size == 1) run_range(config, 0, config.worlds, all);
+    else if (rank == 0) master(config, comm, size, all);
+    else worker(config, comm);
+
+    if (rank != 0) return;
+
+    std::sort(all.begin(), all.end(), [](const WorldResult& a, const WorldResult& b) {
+        return a.world < b.world;
+    });
+    print_summary(config, all);
+    cout << "ensemble took " << MPI_Wtime() - start << " s" << endl;
+}
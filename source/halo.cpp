@@ -0,0 +1,102 @@
+// --------------------
+// Library Includes
+#include "mpi.h"
+
+// --------------------
+// Project Includes
+#include "halo.h"
+
+void halo_create(Halo& halo, const Topology& topo, void* base, int width, int stride, MPI_Datatype element) {
+    int size;
+    MPI_Type_size(element, &size);
+
+    /// Address of element (x, y), where (0, 0) is the first interior element.
+    char* origin = (char*) base;
+    auto at = [&](int x, int y) {
+        return origin + ((long)(y + 1) * stride + (x + 1)) * size;
+    };
+
+    // One interior column, and one interior row.
+    MPI_Type_vector(width, 1, stride, element, &halo.column);
+    MPI_Type_contiguous(width, element, &halo.row);
+    MPI_Type_commit(&halo.column);
+    MPI_Type_commit(&halo.row);
+
+    const int w = width - 1;
+    MPI_Request* r = halo.requests;
+
+    // Receives first, so they are posted before the matching sends start.
+    MPI_Recv_init(at(-1, 0),    1, halo.column, topo.west,       TAG_EAST,       topo.comm, r++);
+    MPI_Recv_init(at(width, 0), 1, halo.column, topo.east,       TAG_WEST,       topo.comm, r++);
+    MPI_Recv_init(at(0, -1),    1, halo.row,    topo.north,      TAG_SOUTH,      topo.comm, r++);
+    MPI_Recv_init(at(0, width), 1, halo.row,    topo.south,      TAG_NORTH,      topo.comm, r++);
+    MPI_Recv_init(at(-1, -1),       1, element, topo.north_west, TAG_SOUTH_EAST, topo.comm, r++);
+    MPI_Recv_init(at(width, -1),    1, element, topo.north_east, TAG_SOUTH_WEST, topo.comm, r++);
+    MPI_Recv_init(at(-1, width),    1, element, topo.south_west, TAG_NORTH_EAST, topo.comm, r++);
+    MPI_Recv_init(at(width, width), 1, element, topo.south_east, TAG_NORTH_WEST, topo.comm, r++);
+
+    MPI_Send_init(at(0, 0), 1, halo.column, topo.west,       TAG_WEST,       topo.comm, r++);
+    MPI_Send_init(at(w, 0), 1, halo.column, topo.east,       TAG_EAST,       topo.comm, r++);
+    MPI_Send_init(at(0, 0), 1, halo.row,    topo.north,      TAG_NORTH,      topo.comm, r++);
+    MPI_Send_init(at(0, w), 1, halo.row,    topo.south,      TAG_SOUTH,      topo.comm, r++);
+    MPI_Send_init(at(0, 0), 1, element,     topo.north_west, TAG_NORTH_WEST, topo.comm, r++);
+    MPI_Send_init(at(w, 0), 1, element,     topo.north_east, TAG_NORTH_EAST, topo.comm, r++);
+    MPI_Send_init(at(0, w), 1, element,     topo.south_west, TAG_SOUTH_WEST, topo.comm, r++);
+    MPI_Send_init(at(w, w), 1, element,     topo.south_east, TAG_SOUTH_EAST, topo.comm, r++);
+}
+
+void halo_free(Halo& halo) {
+    for (MPI_Request& request : halo.requests)
+        MPI_Request_free(&request);
+    MPI_Type_free(&halo.column);
+    MPI_Type_free(&halo.row);
+}
+
+void halo_start(Halo& halo) {
+    MPI_Startall(16, halo.requests);
+}
+
+void halo_finish(Halo& halo) {
+    MPI_Waitall(16, halo.requests, MPI_STATUSES_IGNORE);
+}
+
+bool halo_test(Halo& halo) {
+    int done;
+    MPI_Testall(16, halo.requests, &done, MPI_STATUSES_IGNORE);
+    return done;
+}
+
+void halo_exchange_edges(const Topology& topo, int width, MPI_Datatype element,
+                         const void* north, const void* south, const void* west, const void* east,
+                         void* ghost_north, void* ghost_south, void* ghost_west, void* ghost_east) {
+    int size;
+    MPI_Type_size(element, &size);
+
+    /// Element i of a buffer.
+    auto in = [&](const void* buffer, int i) { return (const char*) buffer + (long) i * size; };
+    auto out = [&](void* buffer, int i) { return (char*) buffer + (long) i * size; };
+
+    const int w = width;
+    MPI_Request requests[16];
+    MPI_Request* r = requests;
+
+    MPI_Irecv(ghost_west,             w, element, topo.west,       TAG_EAST,       topo.comm, r++);
+    MPI_Irecv(ghost_east,             w, element, topo.east,       TAG_WEST,       topo.comm, r++);
+    MPI_Irecv(out(ghost_north, 1),    w, element, topo.north,      TAG_SOUTH,      topo.comm, r++);
+    MPI_Irecv(out(ghost_south, 1),    w, element, topo.south,      TAG_NORTH,      topo.comm, r++);
+    MPI_Irecv(out(ghost_north, 0),    1, element, topo.north_west, TAG_SOUTH_EAST, topo.comm, r++);
+    MPI_Irecv(out(ghost_north, w + 1), 1, element, topo.north_east, TAG_SOUTH_WEST, topo.comm, r++);
+    MPI_Irecv(out(ghost_south, 0),    1, element, topo.south_west, TAG_NORTH_EAST, topo.comm, r++);
+    MPI_Irecv(out(ghost_south, w + 1), 1, element, topo.south_east, TAG_NORTH_WEST, topo.comm, r++);
+
+    MPI_Isend(west,                   w, element, topo.west,       TAG_WEST,       topo.comm, r++);
+    MPI_Isend(east,                   w, element, topo.east,       TAG_EAST,       topo.comm, r++);
+    MPI_Isend(north,                  w, element, topo.north,      TAG_NORTH,      topo.comm, r++);
+    MPI_Isend(south,                  w, element, topo.south,      TAG_SOUTH,      topo.comm, r++);
+    MPI_Isend(in(north, 0),           1, element, topo.north_west, TAG_NORTH_WEST, topo.comm, r++);
+    MPI_Isend(in(north, w - 1),       1, element, topo.north_east, TAG_NORTH_EAST, topo.comm, r++);
+    MPI_Isend(in(south, 0),           1, element, topo.south_west, TAG_SOUTH_WEST, topo.comm, r++);
+    MPI_Isend(in(south, w - 1),       1, element, topo.south_east, TAG_SOUTH_EAST, topo.comm, r++);
+
+    MPI_Waitall(16, requests, MPI_STATUSES_IGNORE);
+}
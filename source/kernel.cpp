@@ -0,0 +1,164 @@
+// --------------------
+// Standard Library
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+#include <algorithm>
+using std::min;
+
+// --------------------
+// Library Includes
+#include <omp.h>
+
+// --------------------
+// Project Includes
+#include "kernel.h"
+
+namespace {
+
+/// Every kernel comes in two forms: the serial one steps a region on the
+/// calling thread, the parallel one splits the region over a team of its
+/// own and hands each thread pieces to step with the serial one.
+
+/// One row at a time.
+void rows_serial(const Sector& s, int x0, int y0, int x1, int y1) {
+    const byte* src = s.cells[s.current];
+    byte* dst = s.cells[s.current ^ 1];
+    const int stride = s.stride;
+
+    for (int y = y0; y < y1; y++) {
+        /// Rows y - 1, y and y + 1, offset so index x is cell x.
+        const byte* n = src + (size_t) y * stride + 1;
+        step_row(n, n + stride, n + 2 * stride, dst + (size_t)(y + 1) * stride + 1, x0, x1);
+    }
+}
+
+/// One row per iteration, rows split evenly over the threads. The rows are
+/// handed out exactly like the first touch in sector_create, so each thread
+/// works on memory local to it.
+void step_rows(const Sector& s, int x0, int y0, int x1, int y1) {
+    #pragma omp parallel for schedule(static)
+    for (int y = y0; y < y1; y++)
+        rows_serial(s, x0, y, x1, y + 1);
+}
+
+/// Square tiles of s.tile cells. Each tile only pulls tile + 2 short rows
+/// through the cache, which pays off once whole rows stop fitting in it.
+void tiles_serial(const Sector& s, int x0, int y0, int x1, int y1) {
+    const int t = s.tile;
+    for (int cy0 = y0; cy0 < y1; cy0 += t)
+        for (int cx0 = x0; cx0 < x1; cx0 += t)
+            rows_serial(s, cx0, cy0, min(cx0 + t, x1), min(cy0 + t, y1));
+}
+
+/// Tiles are dealt out in row order in one contiguous run per thread, so a
+/// thread mostly stays in its first-touch band; only the tile row where two
+/// runs meet is shared with a neighbouring thread.
+void step_tiles(const Sector& s, int x0, int y0, int x1, int y1) {
+    const int t = s.tile;
+    const int across = (x1 - x0 + t - 1) / t, down = (y1 - y0 + t - 1) / t;
+
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (int ty = 0; ty < down; ty++)
+        for (int tx = 0; tx < across; tx++) {
+            int cx0 = x0 + tx * t, cy0 = y0 + ty * t;
+            rows_serial(s, cx0, cy0, min(cx0 + t, x1), min(cy0 + t, y1));
+        }
+}
+
+/// ---------------------------------
+/// Lookup table stepping. A 4x4 neighbourhood, one bit per cell with bit
+/// 4 * row + col, fully decides the next state of its middle 2x2 block;
+/// the table maps each of the 65536 neighbourhoods to that block, with bit
+/// 2 * row + col for the cell at (col, row) of the block. Built on first use.
+const byte* block_table() {
+    static const vector<byte> table = [] {
+        vector<byte> t(1 << 16);
+        for (int index = 0; index < (1 << 16); index++) {
+            auto cell = [&](int col, int row) { return (index >> (4 * row + col)) & 1; };
+            byte block = 0;
+            for (int row = 1; row <= 2; row++)
+                for (int col = 1; col <= 2; col++) {
+                    int neighbours = -cell(col, row);
+                    for (int dy = -1; dy <= 1; dy++)
+                        for (int dx = -1; dx <= 1; dx++)
+                            neighbours += cell(col + dx, row + dy);
+                    int alive = neighbours == 3 || (neighbours == 2 && cell(col, row));
+                    block |= alive << (2 * (row - 1) + (col - 1));
+                }
+            t[index] = block;
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+/// Cells x - 1 to x + 2 of a row as four bits.
+inline unsigned nibble(const byte* row, int x) {
+    return row[x - 1] | row[x] << 1 | row[x + 1] << 2 | row[x + 2] << 3;
+}
+
+/// 2x2 blocks, each from a single table lookup: four loads per cell
+/// instead of nine, and no comparisons. Odd leftover rows and columns fall
+/// back to step_row.
+void blocks_serial(const Sector& s, int x0, int y0, int x1, int y1) {
+    const byte* table = block_table();
+    const byte* src = s.cells[s.current];
+    byte* dst = s.cells[s.current ^ 1];
+    const int stride = s.stride;
+    const int x_even = x0 + (x1 - x0) / 2 * 2;
+
+    int y = y0;
+    for (; y + 2 <= y1; y += 2) {
+        /// Rows y - 1 to y + 2 in, rows y and y + 1 out.
+        const byte* r0 = src + (size_t) y * stride + 1;
+        const byte* r1 = r0 + stride;
+        const byte* r2 = r1 + stride;
+        const byte* r3 = r2 + stride;
+        byte* out0 = dst + (size_t)(y + 1) * stride + 1;
+        byte* out1 = out0 + stride;
+
+        for (int x = x0; x < x_even; x += 2) {
+            byte block = table[nibble(r0, x) | nibble(r1, x) << 4 | nibble(r2, x) << 8 | nibble(r3, x) << 12];
+            out0[x] = block & 1;
+            out0[x + 1] = (block >> 1) & 1;
+            out1[x] = (block >> 2) & 1;
+            out1[x + 1] = block >> 3;
+        }
+
+        if (x_even < x1) {
+            step_row(r0, r1, r2, out0, x_even, x1);
+            step_row(r1, r2, r3, out1, x_even, x1);
+        }
+    }
+
+    if (y < y1) rows_serial(s, x0, y, x1, y1);
+}
+
+/// Row pairs are split like the rows of the first touch, so a band
+/// boundary can be off by at most one row. An odd last row is a pair of
+/// its own.
+void step_blocks(const Sector& s, int x0, int y0, int x1, int y1) {
+    const int pairs = (y1 - y0 + 1) / 2;
+
+    #pragma omp parallel for schedule(static)
+    for (int p = 0; p < pairs; p++)
+        blocks_serial(s, x0, y0 + 2 * p, x1, min(y0 + 2 * p + 2, y1));
+}
+
+}
+
+const KernelInfo kernels[] = {
+    {"rows", step_rows, rows_serial, false},
+    {"tiles", step_tiles, tiles_serial, true},
+    {"lut", step_blocks, blocks_serial, false},
+};
+
+const int kernel_count = sizeof(kernels) / sizeof(kernels[0]);
+
+int find_kernel(const string& name) {
+    for (int i = 0; i < kernel_count; i++)
+        if (name == kernels[i].name) return i;
+    return -1;
+}
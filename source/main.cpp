@@ -1,211 +1,289 @@
 // --------------------
-// Standard Library 
+// Standard Library
 #include <iostream>
 using std::cout;
 using std::endl;
-#include <tgmath.h>
-using std::sqrt;
-#include<vector>
-using std::vector;
-#include<set>
-using std::set;
-
-// used for rand
 #include <cstdlib>
-#include <ctime>
+#include <cstdint>
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+#include <algorithm>
 
 // --------------------
 // Library Includes
 #include "mpi.h"
+#include <omp.h>
 
 // --------------------
-// Typedefs
-typedef unsigned char byte;
+// Project Includes
+#include "config.h"
+#include "topology.h"
+#include "sector.h"
+#include "halo.h"
+#include "pyramid.h"
+#include "delta_log.h"
+#include "out_of_core.h"
+#include "autotune.h"
+#include "ensemble.h"
+#include "census.h"
+#include "dataflow.h"
+
+/// Prints the whole world on rank 0 as ASCII art at most `columns` characters
+/// wide, zooming out by whole pyramid levels until it fits. Each character
+/// shows how crowded its block is. Collective over topo.comm.
+void print_world(const Topology& topo, const Sector& sector, const Pyramid& pyramid, int columns, int generation) {
+    long world_width = (long) topo.dims[1] * sector.width;
+    long world_height = (long) topo.dims[0] * sector.width;
+
+    Viewport view;
+    view.level = 0;
+    while ((world_width >> view.level) + 1 > columns) view.level++;
+    view.x = view.y = 0;
+    view.width = (world_width + (1l << view.level) - 1) >> view.level;
+    view.height = (world_height + (1l << view.level) - 1) >> view.level;
+
+    vector<uint64_t> counts = query_viewport(topo, sector, pyramid, view, 0);
+    if (topo.rank != 0) return;
+
+    const char shades[] = " .:-=+*#%@";
+    const int steps = sizeof(shades) - 2;
+    const long block = 1l << view.level;
+
+    cout << "generation " << generation << " (1 character = " << block << "x" << block << " cells)" << endl;
+    for (int y = 0; y < view.height; y++) {
+        string line;
+        for (int x = 0; x < view.width; x++) {
+            /// Blocks on the far edges may be cut off by the end of the world.
+            long area = std::min(block, world_width - x * block) * std::min(block, world_height - y * block);
+            uint64_t live = counts[(size_t) y * view.width + x];
+            line += shades[live == 0 ? 0 : 1 + (live * (steps - 1)) / area];
+        }
+        cout << line << endl;
+    }
+}
+
+/// Prints the current generation on rank 0 if --progress seconds have passed
+/// since the last time. Only looks at the clock, never waits.
+void report_progress(const Topology& topo, const Config& config, int generation, double& last_report) {
+    if (topo.rank != 0 || config.progress <= 0) return;
+    double now = MPI_Wtime();
+    if (now - last_report >= config.progress) {
+        cout << "generation " << generation << " / " << config.runtime << endl;
+        last_report = now;
+    }
+}
+
+/// Prints the population of the whole world on rank 0. Collective over topo.comm.
+void report_population(const Topology& topo, const Config& config, long population) {
+    long total = 0;
+    MPI_Reduce(&population, &total, 1, MPI_LONG, MPI_SUM, 0, topo.comm);
+    if (topo.rank == 0 && config.report)
+        cout << "population " << total << " after " << config.runtime << " generations" << endl;
+}
+
+/// Generations from `generation` until the next one that is logged, viewed,
+/// counted or the last, whichever comes first.
+int generations_to_next_observation(const Config& config, int generation) {
+    int next = config.runtime;
+    if (!config.log_dir.empty()) next = generation + 1;
+    if (config.view_every > 0) next = std::min(next, (generation / config.view_every + 1) * config.view_every);
+    if (config.census_every > 0) next = std::min(next, (generation / config.census_every + 1) * config.census_every);
+    return next - generation;
+}
+
+/// The normal mode: every sector is held in memory.
+void run_in_core(const Config& config, const Topology& topo) {
+
+    /// The sector holds this field's data and the halo. The halo will be
+    /// syncronized with each surrounding field. Its memory is first touched
+    /// by the threads that update it, so set the thread count and pin
+    /// before creating it.
+    int sector_width = config.sector_width;
+    long x0 = (long) topo.coords[1] * sector_width, y0 = (long) topo.coords[0] * sector_width;
+    Tuning tuning = configured_tuning(config, topo.rank);
+    omp_set_num_threads(tuning.threads);
+    if (config.pin) pin_threads(topo);
+    Sector sector = sector_create(sector_width, x0, y0);
+    sector_randomize(sector, config.density, config.seed);
+    apply_tuning(tuning, sector);
+
+    /// Pick the kernel, tile size and thread count by measurement if asked.
+    /// The tuner needs a real sector to time; if it settles on another
+    /// thread count the rows now belong to other threads, so pin the new
+    /// team and touch them again.
+    if (config.tune) {
+        Tuning tuned = autotune(topo, config, sector);
+        if (tuned.threads != tuning.threads) {
+            if (config.pin) pin_threads(topo);
+            sector_free(sector);
+            sector = sector_create(sector_width, x0, y0);
+            sector_randomize(sector, config.density, config.seed);
+            apply_tuning(tuned, sector);
+        }
+    }
 
-// --------------------
-// Configuration Constants
-const int sector_width = 20;
-const int runtime = 100;
+    /// One set of persistent requests per buffer, since the buffers swap every generation.
+    Halo halo[2];
+    for (int b = 0; b < 2; b++)
+        halo_create(halo[b], topo, sector.cells[b], sector_width, sector.stride, MPI_BYTE);
 
-int main(int argc, char* argv[]) {
+    if (config.report)
+        report_mapping(topo, sector.cells[0], (size_t) sector.stride * sector.stride);
 
-    // ---------------------------------
-    // MPI Setup 
-    MPI_Init(&argc, &argv);
-    
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    /// The population pyramid is only maintained when something looks at it.
+    Pyramid pyramid;
+    if (config.view_every > 0) pyramid = pyramid_create(sector);
 
-    /// ---------------------------------
-    /// Configuring this sector:
-    /// This program treats the processes like a matrix.
-    /// We need to figure out our position in the world, and how
-    /// we relate to other processes. 
-
-    int world_width = sqrt(size);
-    if (size != (world_width * world_width)) {
-        if (rank == 0) 
-            cout << "Size must be perfect square: 4, 9, 16, etc." << endl;
-        MPI_Finalize();
-        return 0;
+    DeltaLog log;
+    if (!config.log_dir.empty())
+        log = delta_log_open(config.log_dir, topo, sector, config.keyframe_every);
+
+    Census census;
+    if (config.census_every > 0)
+        census = census_create(sector, config.census_top);
+
+    /// There is no global barrier between generations. Each rank only waits
+    /// for its neighbours' halos, computing its interior while they arrive.
+    double last_report = MPI_Wtime();
+    double per_generation = 0;  // seconds, as measured on the last chunk
+
+    for (int i_ = 0; i_ < config.runtime; ) {
+
+        /// The dataflow executor runs freely up to the next generation
+        /// something wants to look at; otherwise go one generation at a time.
+        /// Progress is only reported between chunks, so with --progress keep
+        /// a chunk to about one interval at the speed measured so far.
+        int steps = config.dataflow ? generations_to_next_observation(config, i_) : 1;
+        if (steps > 1 && config.progress > 0)
+            steps = per_generation > 0 ? std::max(1, (int) std::min<double>(steps, config.progress / per_generation)) : 1;
+
+        double start = MPI_Wtime();
+        if (steps > 1) {
+            dataflow_run(sector, halo, steps);
+        }
+        else {
+            Halo& exchange = halo[sector.current];
+            halo_start(exchange);
+            sector_step_interior(sector);
+            halo_finish(exchange);
+            sector_step_border(sector);
+            sector_swap(sector);
+        }
+        per_generation = (MPI_Wtime() - start) / steps;
+        i_ += steps;
+
+        if (!config.log_dir.empty())
+            delta_log_record(log, sector, i_);
+
+        if (config.view_every > 0) {
+            /// The incremental update only sees the last generation.
+            if (steps > 1) pyramid = pyramid_create(sector);
+            else pyramid_update(pyramid, sector);
+            if (i_ % config.view_every == 0)
+                print_world(topo, sector, pyramid, config.view_columns, i_);
+        }
+
+        if (config.census_every > 0 && i_ % config.census_every == 0)
+            census_run(census, topo, sector, i_);
+
+        report_progress(topo, config, i_, last_report);
     }
 
-    /// Think of the processes as a vector, or 1d array. 
-    /// We need to find the index of the process in 2d, so we can
-    /// find and communicate with its neighbours. 
-    int row = rank / world_width;
-    int col = rank % world_width;
+    report_population(topo, config, sector_population(sector));
 
-    /// Byte data contains this fields data, and the halo.
-    /// The halo will be syncronized with each surrounding fields.
-    byte data[(sector_width + 1)* (sector_width + 1)];
+    if (config.census_every > 0)
+        census_free(census);
 
-    int field_width = sector_width - 1;
-    int data_width = sector_width;
+    for (int b = 0; b < 2; b++)
+        halo_free(halo[b]);
 
-    // Index the data we need on the horizontal axis
-    MPI_Datatype HORI_TYPE;
-    MPI_Type_vector(field_width, 1, data_width, MPI_BYTE, &HORI_TYPE);
+    if (!config.log_dir.empty())
+        delta_log_close(log);
 
-    // index the data we need on the vertical axis
-    MPI_Datatype VERT_TYPE;
-    MPI_Type_contiguous(data_width, MPI_BYTE, &VERT_TYPE);
+    sector_free(sector);
+}
 
-    // register new type with MPI
-    MPI_Type_commit(&HORI_TYPE);
-    MPI_Type_commit(&VERT_TYPE);
+/// Out-of-core mode: every sector is streamed from memory mapped files.
+void run_out_of_core(const Config& config, const Topology& topo) {
+    if (topo.rank == 0 && (config.view_every > 0 || !config.log_dir.empty() || config.census_every > 0))
+        cout << "--view, --log and --census need an in-core sector and are ignored with --out-of-core" << endl;
 
-    /// Cache array to hold the data while updating (so no overwrite)
-    byte cache[sector_width * sector_width];
+    if (config.threads > 0) omp_set_num_threads(config.threads);
+    if (config.pin) pin_threads(topo);
 
-    /// fill data with random values.
-    for (int i = 0; i < data_width * data_width; i++) {
-        data[i] = std::rand() / ((RAND_MAX + 1u) / 6) == 0 ? 1 : 0;
-    }
+    OutOfCore sector = out_of_core_create(config.out_of_core_dir, topo, config.sector_width,
+        config.band, config.density, config.seed);
 
-    /// Create MPI Requests for each possible side.
-    int verts = 2, horis = 2;
-    if (row == 0) verts--;
-    if (col == 0) horis--;
-    if (row == world_width) verts--;
-    if (col == world_width) horis--;
-
-    MPI_Request* hori_reqs = (MPI_Request*) malloc(sizeof(MPI_Request) * horis * 2);
-    MPI_Request* vert_reqs = (MPI_Request*) malloc(sizeof(MPI_Request) * verts * 2);
-
-    byte** buffer;
-    int m = (sector_width + 1) * (1 + sector_width);
-    if (rank == 0) {
-        buffer = (byte**) malloc(sizeof(byte*) * size);
-        for (int i = 0; i < size + 1; i++) {
-            buffer[i] = (byte*) malloc(sizeof(byte) * m);
-        }
+    /// The files are mostly on disk; the window bands are the memory that
+    /// is actually worked on, and they are allocated together on this thread.
+    if (config.report)
+        report_mapping(topo, sector.window[0].data(), sector.window[0].size());
+
+    double last_report = MPI_Wtime();
+
+    for (int i_ = 0; i_ < config.runtime; i_++) {
+        out_of_core_step(sector, topo);
+        report_progress(topo, config, i_ + 1, last_report);
     }
 
-    // used within the loop
-    double start;
-    double end = 0;
+    report_population(topo, config, out_of_core_population(sector));
 
-    for (int i_ = 0; i_ < runtime; i_++) {
+    out_of_core_free(sector);
+}
 
-        // Mandatory waiting period so we can see it run. 
-        // set to -1 if testing for speed. 
-        if (rank == 0) {
-            start = MPI_Wtime();
-            while (end - start < 0.2)
-                end = MPI_Wtime();
-        }
+int main(int argc, char* argv[]) {
 
-        MPI_Barrier(MPI_COMM_WORLD);
-
-        int a = 0;
-        // if not on west side / send west
-        // HORIZONTAL SEND / RECEIVE
-        if (col != 0) {
-            MPI_Request send;
-            MPI_Request recv;
-            MPI_Send_init(&data[data_width + 2], 1, HORI_TYPE, rank - 1, 0, MPI_COMM_WORLD, &send);
-            MPI_Recv_init(&data[data_width + 1], 1, HORI_TYPE, rank - 1, 0, MPI_COMM_WORLD, &recv);
-            hori_reqs[a] = send;
-            hori_reqs[a + 1] = recv;
-            a += 2;
-        }
-        // if not on east side / send east
-        // HORIZONTAL SEND / RECEIVE
-        if (col != world_width - 1) {
-            MPI_Request send;
-            MPI_Request recv;
-            MPI_Send_init(&data[(data_width * 2) - 2], 1, HORI_TYPE, rank + 1, 0, MPI_COMM_WORLD, &send);
-            MPI_Recv_init(&data[(data_width * 2) - 1], 1, HORI_TYPE, rank + 1, 0, MPI_COMM_WORLD, &recv);
-            hori_reqs[a] = send;
-            hori_reqs[a + 1] = recv;
-        }
+    // ---------------------------------
+    // MPI Setup
+    // The dataflow executor calls MPI from inside OpenMP tasks, one call at a time.
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
 
-        MPI_Startall(horis, hori_reqs);
-        MPI_Waitall(horis, hori_reqs, MPI_STATUS_IGNORE);
-
-        a = 0;
-        // where are we in the process world?
-        // if not on north side / send north
-        // VERTICAL SEND / RECEIVE
-        if (row != 0) {
-            MPI_Request send;
-            MPI_Request recv;
-            MPI_Send_init(&data[data_width], 1, VERT_TYPE, rank - world_width, 0, MPI_COMM_WORLD, &send);
-            MPI_Recv_init(&data[0], 1, VERT_TYPE, rank - world_width, 0, MPI_COMM_WORLD, &recv);
-            vert_reqs[a] = send;
-            vert_reqs[a + 1] = recv;
-            a += 2;
-        }
-        // if not on south side / send south
-        // VERTICAL SEND / RECEIVE
-        if (row != world_width - 1) {
-            MPI_Request send;
-            MPI_Request recv;
-            MPI_Send_init(&data[data_width * (data_width - 2)], 1, VERT_TYPE, rank + world_width, 0, MPI_COMM_WORLD, &send);
-            MPI_Recv_init(&data[data_width * (data_width - 1)], 1, VERT_TYPE, rank + world_width, 0, MPI_COMM_WORLD, &recv);
-            vert_reqs[a] = send;
-            vert_reqs[a + 1] = recv;
-        }
+    int world_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+    Config config = parse_args(argc, argv, world_rank);
 
-        MPI_Startall(verts, vert_reqs);
-        MPI_Waitall(verts, vert_reqs, MPI_STATUS_IGNORE);
-
-        for (int x = 1; x < field_width; x++)
-            for (int y = 1; y < field_width; y++)
-                cache[(x - 1) + field_width * (y - 1)] = 
-                    data[(x - 1) + data_width * y] + data[(x + 1) + data_width * y] +
-                    data[x + data_width * (y - 1)] + data[x + data_width * (y + 1)] +
-                    data[(x + 1) + data_width * (y - 1)] + data[(x - 1) + data_width * (y - 1)] +
-                    data[(x + 1) + data_width * (y + 1)] + data[(x - 1) + data_width * (y + 1)];
-
-        for (int x = 1; x < field_width; x++)
-            for (int y = 1; y < field_width; y++) {
-                byte neighbours = cache[(x - 1) + field_width * (y - 1)];
-                byte alive = 0;
-                if (neighbours == 3) alive = 1;
-                if (neighbours != 2) data[x + field_width * y] = alive;  
-            }
-
-        for (int i = 0; i < verts; i++)
-            MPI_Request_free(&vert_reqs[i]);
-
-        for (int i = 0; i < horis; i++)
-            MPI_Request_free(&hori_reqs[i]);
+    if (config.dataflow && provided < MPI_THREAD_SERIALIZED) {
+        if (world_rank == 0)
+            cout << "MPI cannot be called from tasks here, running generations in lock-step instead" << endl;
+        config.dataflow = false;
     }
 
-    MPI_Type_free(&HORI_TYPE);
-    MPI_Type_free(&VERT_TYPE);
+    /// Replay is a single process job: rebuild one frame from the logs and stop.
+    if (!config.replay_dir.empty()) {
+        bool ok = true;
+        if (world_rank == 0)
+            ok = delta_log_replay(config.replay_dir, config.replay_generation, config.replay_output);
+        MPI_Finalize();
+        return ok ? 0 : 1;
+    }
 
-    free(hori_reqs);
-    free(vert_reqs);
+    /// Ensemble runs are independent small worlds; they need no process grid.
+    if (config.ensemble) {
+        if (config.threads > 0) omp_set_num_threads(config.threads);
+        run_ensemble(config, MPI_COMM_WORLD);
+        MPI_Finalize();
+        return 0;
+    }
+
+    /// ---------------------------------
+    /// Configuring this sector:
+    /// This program treats the processes like a matrix. The cartesian
+    /// communicator works out our position in the world and who our
+    /// neighbours are, and may renumber the ranks so that neighbours
+    /// share a node. From here on only topo.comm is used.
+    Topology topo = topology_create(MPI_COMM_WORLD);
 
-    for (int i = 0; i < size; i++)
-        free(buffer[i]);
+    if (config.out_of_core_dir.empty())
+        run_in_core(config, topo);
+    else
+        run_out_of_core(config, topo);
 
-    free(buffer);
+    topology_free(topo);
 
     MPI_Finalize();
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,240 @@
+// --------------------
+// Standard Library
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+#include <algorithm>
+using std::min;
+#include <cstring>
+#include <cerrno>
+
+// used for the memory mapped files
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// --------------------
+// Library Includes
+#include "mpi.h"
+#include <omp.h>
+
+// --------------------
+// Project Includes
+#include "out_of_core.h"
+#include "halo.h"
+
+namespace {
+
+void fail(const Topology& topo, const string& what) {
+    cout << "Rank " << topo.rank << ": " << what << ": " << strerror(errno) << endl;
+    MPI_Abort(topo.comm, 1);
+}
+
+/// Packed row y of generation buffer `bits`.
+inline byte* packed_row(const OutOfCore& s, byte* bits, long y) {
+    return bits + y * s.row_bytes;
+}
+
+void pack(const byte* cells, byte* packed, int width) {
+    for (int i = 0; i < (width + 7) / 8; i++) {
+        byte b = 0;
+        for (int k = 0; k < 8 && 8 * i + k < width; k++)
+            b |= cells[8 * i + k] << k;
+        packed[i] = b;
+    }
+}
+
+void unpack(const byte* packed, byte* cells, int width) {
+    for (int x = 0; x < width; x++)
+        cells[x] = (packed[x >> 3] >> (x & 7)) & 1;
+}
+
+/// Byte range [begin, end) of buffer `bits`, widened to whole pages as madvise and msync want.
+void page_range(byte* bits, size_t begin, size_t end, size_t limit, byte*& start, size_t& length) {
+    static const size_t page = sysconf(_SC_PAGESIZE);
+    end = min(end, limit);
+    size_t aligned = begin / page * page;
+    start = bits + aligned;
+    length = end > aligned ? end - aligned : 0;
+}
+
+void advise(OutOfCore& s, byte* bits, long first_row, long rows, int advice) {
+    byte* start;
+    size_t length;
+    page_range(bits, first_row * s.row_bytes, (first_row + rows) * s.row_bytes, s.file_bytes, start, length);
+    if (length) madvise(start, length, advice);
+}
+
+void write_back(OutOfCore& s, byte* bits, long first_row, long rows) {
+    byte* start;
+    size_t length;
+    page_range(bits, first_row * s.row_bytes, (first_row + rows) * s.row_bytes, s.file_bytes, start, length);
+    if (length) msync(start, length, MS_ASYNC);
+}
+
+/// Unpacks rows [first, first + count) of the current generation into a
+/// window slot, adding the ghost columns on either side.
+void load_band(OutOfCore& s, vector<byte>& slot, long first, int count) {
+    const int stride = s.width + 2;
+    byte* bits = s.bits[s.current];
+
+    #pragma omp parallel for schedule(static)
+    for (int r = 0; r < count; r++) {
+        byte* row = slot.data() + (size_t) r * stride;
+        row[0] = s.ghost_west[first + r];
+        unpack(packed_row(s, bits, first + r), row + 1, s.width);
+        row[s.width + 1] = s.ghost_east[first + r];
+    }
+}
+
+/// Records the edges of a freshly computed row of the next generation.
+void keep_edges(OutOfCore& s, int next, long y, const byte* row) {
+    s.west[next][y] = row[0];
+    s.east[next][y] = row[s.width - 1];
+    if (y == 0) memcpy(s.top[next].data(), row, s.width);
+    if (y == s.width - 1) memcpy(s.bottom[next].data(), row, s.width);
+}
+
+/// Sends this generation's edges and receives the neighbours', neighbour-only like the in-core halo.
+void exchange_edges(OutOfCore& s, const Topology& topo) {
+    const int c = s.current;
+
+    /// At the edge of the world nothing arrives, and the ghosts must read as dead.
+    for (vector<byte>* ghost : {&s.ghost_north, &s.ghost_south, &s.ghost_west, &s.ghost_east})
+        std::fill(ghost->begin(), ghost->end(), 0);
+
+    halo_exchange_edges(topo, s.width, MPI_BYTE,
+        s.top[c].data(), s.bottom[c].data(), s.west[c].data(), s.east[c].data(),
+        s.ghost_north.data(), s.ghost_south.data(), s.ghost_west.data(), s.ghost_east.data());
+}
+
+}
+
+OutOfCore out_of_core_create(const string& dir, const Topology& topo, int width, int band,
+                             int density, unsigned seed) {
+    OutOfCore s;
+    s.width = width;
+    s.band = std::max(1, min(band, width));
+    s.x0 = (long) topo.coords[1] * width;
+    s.y0 = (long) topo.coords[0] * width;
+    s.row_bytes = (width + 7) / 8;
+    s.file_bytes = s.row_bytes * width;
+    s.current = 0;
+
+    for (int b = 0; b < 2; b++) {
+        s.paths[b] = dir + "/sector_" + std::to_string(topo.rank) + "_" + std::to_string(b) + ".bits";
+        s.files[b] = open(s.paths[b].c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (s.files[b] < 0) fail(topo, "could not create " + s.paths[b]);
+        if (ftruncate(s.files[b], s.file_bytes) != 0) fail(topo, "could not size " + s.paths[b]);
+
+        s.bits[b] = (byte*) mmap(nullptr, s.file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, s.files[b], 0);
+        if (s.bits[b] == MAP_FAILED) fail(topo, "could not map " + s.paths[b]);
+
+        /// Both files are always walked front to back.
+        madvise(s.bits[b], s.file_bytes, MADV_SEQUENTIAL);
+
+        s.top[b].assign(width, 0);
+        s.bottom[b].assign(width, 0);
+        s.west[b].assign(width, 0);
+        s.east[b].assign(width, 0);
+    }
+
+    s.ghost_north.assign(width + 2, 0);
+    s.ghost_south.assign(width + 2, 0);
+    s.ghost_west.assign(width, 0);
+    s.ghost_east.assign(width, 0);
+    for (int k = 0; k < 3; k++)
+        s.window[k].assign((size_t) s.band * (width + 2), 0);
+
+    /// Write generation 0 a row at a time, the same world sector_randomize makes.
+    #pragma omp parallel
+    {
+        vector<byte> row(width);
+        #pragma omp for schedule(static)
+        for (int y = 0; y < width; y++) {
+            for (int x = 0; x < width; x++)
+                row[x] = initial_cell(seed, density, s.x0 + x, s.y0 + y);
+            pack(row.data(), packed_row(s, s.bits[0], y), width);
+            keep_edges(s, 0, y, row.data());
+        }
+    }
+    write_back(s, s.bits[0], 0, width);
+
+    return s;
+}
+
+void out_of_core_free(OutOfCore& s) {
+    for (int b = 0; b < 2; b++) {
+        munmap(s.bits[b], s.file_bytes);
+        close(s.files[b]);
+        unlink(s.paths[b].c_str());
+    }
+}
+
+void out_of_core_step(OutOfCore& s, const Topology& topo) {
+    exchange_edges(s, topo);
+
+    const int w = s.width, B = s.band, stride = w + 2;
+    const int next = s.current ^ 1;
+    const int bands = (w + B - 1) / B;
+    byte* src = s.bits[s.current];
+    byte* dst = s.bits[next];
+
+    /// Row y of the current generation, with ghost columns, for y in [-1, w].
+    auto row = [&](long y) -> const byte* {
+        if (y < 0) return s.ghost_north.data();
+        if (y >= w) return s.ghost_south.data();
+        return s.window[(y / B) % 3].data() + (size_t)(y % B) * stride;
+    };
+
+    load_band(s, s.window[0], 0, min(B, w));
+
+    for (int k = 0; k < bands; k++) {
+        long first = (long) k * B;
+        int count = min((long) B, w - first);
+
+        /// Slide the window: bring in the band below, which reuses the slot of
+        /// the band two above, and ask for the one after it to be read ahead.
+        if (k + 1 < bands) {
+            long below = first + B;
+            load_band(s, s.window[(k + 1) % 3], below, min((long) B, w - below));
+            advise(s, src, below + B, B, MADV_WILLNEED);
+        }
+
+        #pragma omp parallel
+        {
+            vector<byte> out(w);
+            #pragma omp for schedule(static)
+            for (int r = 0; r < count; r++) {
+                long y = first + r;
+                step_row(row(y - 1) + 1, row(y) + 1, row(y + 1) + 1, out.data(), 0, w);
+                pack(out.data(), packed_row(s, dst, y), w);
+                keep_edges(s, next, y, out.data());
+            }
+        }
+
+        /// The finished band can start going to disk, and the band above it
+        /// has been unpacked for the last time.
+        write_back(s, dst, first, count);
+        if (k > 0) advise(s, src, first - B, B, MADV_DONTNEED);
+    }
+
+    s.current = next;
+}
+
+long out_of_core_population(const OutOfCore& s) {
+    const byte* bits = s.bits[s.current];
+    long total = 0;
+
+    #pragma omp parallel for schedule(static) reduction(+ : total)
+    for (int y = 0; y < s.width; y++) {
+        const byte* packed = bits + (size_t) y * s.row_bytes;
+        for (size_t i = 0; i < s.row_bytes; i++)
+            total += __builtin_popcount(packed[i]);
+    }
+    return total;
+}
@@ -0,0 +1,215 @@
+// --------------------
+// Standard Library
+#include <vector>
+using std::vector;
+#include <algorithm>
+using std::min;
+using std::max;
+#include <cstring>
+
+// --------------------
+// Library Includes
+#include "mpi.h"
+#include <omp.h>
+
+// --------------------
+// Project Includes
+#include "pyramid.h"
+
+namespace {
+
+const int TAG_VIEWPORT = 100;
+
+/// Sums the cells of [x0, x1) x [y0, y1) directly.
+uint64_t count_cells(const Sector& s, const byte* cells, int x0, int y0, int x1, int y1) {
+    uint64_t total = 0;
+    for (int y = y0; y < y1; y++) {
+        const byte* row = cells + cell_index(s, 0, y);
+        for (int x = x0; x < x1; x++)
+            total += row[x];
+    }
+    return total;
+}
+
+/// Live cells in the intersection of node (i, j) of level k with the rectangle.
+uint64_t count_node(const Pyramid& p, const Sector& s, int k, int i, int j, int x0, int y0, int x1, int y1) {
+    int nx0 = i << k, ny0 = j << k;
+    int nx1 = min(nx0 + (1 << k), p.width), ny1 = min(ny0 + (1 << k), p.width);
+
+    int ax = max(nx0, x0), ay = max(ny0, y0);
+    int bx = min(nx1, x1), by = min(ny1, y1);
+    if (ax >= bx || ay >= by) return 0;
+
+    bool inside = ax == nx0 && ay == ny0 && bx == nx1 && by == ny1;
+    if (inside && k >= p.tile_shift) return p.counts[k][(size_t) j * p.sizes[k] + i];
+    if (k <= p.tile_shift) return count_cells(s, s.cells[s.current], ax, ay, bx, by);
+
+    uint64_t total = 0;
+    for (int c = 0; c < 4; c++) {
+        int ci = 2 * i + (c & 1), cj = 2 * j + (c >> 1);
+        if (ci < p.sizes[k - 1] && cj < p.sizes[k - 1])
+            total += count_node(p, s, k - 1, ci, cj, x0, y0, x1, y1);
+    }
+    return total;
+}
+
+/// Recomputes every dirty cell of level k from its children on level k - 1.
+void update_level(Pyramid& p, int k) {
+    const int size = p.sizes[k], child_size = p.sizes[k - 1];
+    const vector<uint64_t>& child = p.counts[k - 1];
+    const vector<byte>& child_dirty = p.dirty[k - 1];
+
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < size; j++)
+        for (int i = 0; i < size; i++) {
+            uint64_t total = 0;
+            byte changed = 0;
+            for (int c = 0; c < 4; c++) {
+                int ci = 2 * i + (c & 1), cj = 2 * j + (c >> 1);
+                if (ci < child_size && cj < child_size) {
+                    size_t at = (size_t) cj * child_size + ci;
+                    total += child[at];
+                    changed |= child_dirty[at];
+                }
+            }
+            size_t at = (size_t) j * size + i;
+            p.dirty[k][at] = changed;
+            if (changed) p.counts[k][at] = total;
+        }
+}
+
+/// The range of level k blocks that overlap [begin, begin + length), clipped to the viewport.
+void overlap(long begin, long length, int k, long view_begin, long view_length, long& first, long& last) {
+    first = max(view_begin, begin >> k);
+    last = min(view_begin + view_length, (begin + length + (1l << k) - 1) >> k);
+}
+
+}
+
+Pyramid pyramid_create(const Sector& s, int tile_shift) {
+    Pyramid p;
+    p.width = s.width;
+    p.tile_shift = tile_shift;
+
+    /// Enough levels for the top one to be a single cell, and at least one stored level.
+    p.levels = 1;
+    while ((1l << (p.levels - 1)) < s.width) p.levels++;
+    p.levels = max(p.levels, tile_shift + 1);
+
+    p.sizes.resize(p.levels);
+    p.counts.resize(p.levels);
+    p.dirty.resize(p.levels);
+    for (int k = 0; k < p.levels; k++) {
+        p.sizes[k] = (int)((s.width + (1l << k) - 1) >> k);
+        if (k >= tile_shift) {
+            size_t cells = (size_t) p.sizes[k] * p.sizes[k];
+            p.counts[k].assign(cells, 0);
+            p.dirty[k].assign(cells, 1);
+        }
+    }
+
+    const int t = tile_shift, tiles = p.sizes[t];
+    const byte* cells = s.cells[s.current];
+
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < tiles; j++)
+        for (int i = 0; i < tiles; i++)
+            p.counts[t][(size_t) j * tiles + i] = count_cells(s, cells,
+                i << t, j << t, min((i + 1) << t, s.width), min((j + 1) << t, s.width));
+
+    for (int k = t + 1; k < p.levels; k++)
+        update_level(p, k);
+
+    return p;
+}
+
+void pyramid_update(Pyramid& p, const Sector& s) {
+    const byte* now = s.cells[s.current];
+    const byte* before = s.cells[s.current ^ 1];
+    const int t = p.tile_shift, tiles = p.sizes[t];
+
+    /// A tile is recounted only if one of its rows differs from the last generation.
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < tiles; j++)
+        for (int i = 0; i < tiles; i++) {
+            int x0 = i << t, y0 = j << t;
+            int x1 = min(x0 + (1 << t), s.width), y1 = min(y0 + (1 << t), s.width);
+
+            byte changed = 0;
+            for (int y = y0; y < y1 && !changed; y++) {
+                size_t at = cell_index(s, x0, y);
+                changed = memcmp(now + at, before + at, x1 - x0) != 0;
+            }
+
+            size_t at = (size_t) j * tiles + i;
+            p.dirty[t][at] = changed;
+            if (changed) p.counts[t][at] = count_cells(s, now, x0, y0, x1, y1);
+        }
+
+    for (int k = t + 1; k < p.levels; k++)
+        update_level(p, k);
+}
+
+uint64_t pyramid_count(const Pyramid& p, const Sector& s, int x0, int y0, int x1, int y1) {
+    return count_node(p, s, p.levels - 1, 0, 0, x0, y0, x1, y1);
+}
+
+vector<uint64_t> query_viewport(const Topology& topo, const Sector& s, const Pyramid& p, Viewport view, int root) {
+    MPI_Bcast(&view, sizeof(Viewport), MPI_BYTE, root, topo.comm);
+    const int k = view.level;
+    const long w = s.width;
+
+    /// The blocks of the viewport that overlap the sector at grid position (row, col).
+    auto blocks = [&](int row, int col, long& bx0, long& by0, long& bx1, long& by1) {
+        overlap(col * w, w, k, view.x, view.width, bx0, bx1);
+        overlap(row * w, w, k, view.y, view.height, by0, by1);
+        return bx0 < bx1 && by0 < by1;
+    };
+
+    /// This rank's share: the partial count of every overlapping block.
+    long bx0, by0, bx1, by1;
+    vector<uint64_t> mine;
+    if (blocks(topo.coords[0], topo.coords[1], bx0, by0, bx1, by1)) {
+        mine.resize((bx1 - bx0) * (by1 - by0));
+
+        #pragma omp parallel for schedule(static)
+        for (long by = by0; by < by1; by++)
+            for (long bx = bx0; bx < bx1; bx++) {
+                /// Block corners in sector coordinates; pyramid_count clips them.
+                long x0 = (bx << k) - s.x0, y0 = (by << k) - s.y0;
+                long x1 = x0 + (1l << k), y1 = y0 + (1l << k);
+                mine[(by - by0) * (bx1 - bx0) + (bx - bx0)] = pyramid_count(p, s,
+                    (int) max(x0, 0l), (int) max(y0, 0l), (int) min(x1, w), (int) min(y1, w));
+            }
+
+        if (topo.rank != root)
+            MPI_Send(mine.data(), mine.size(), MPI_UINT64_T, root, TAG_VIEWPORT, topo.comm);
+    }
+
+    if (topo.rank != root) return vector<uint64_t>();
+
+    /// A block can straddle several sectors, so the shares are summed.
+    vector<uint64_t> result((size_t) view.width * view.height, 0);
+    vector<uint64_t> share;
+    for (int row = 0; row < topo.dims[0]; row++)
+        for (int col = 0; col < topo.dims[1]; col++) {
+            if (!blocks(row, col, bx0, by0, bx1, by1)) continue;
+
+            int coords[2] = {row, col}, owner;
+            MPI_Cart_rank(topo.comm, coords, &owner);
+
+            const vector<uint64_t>* part = &mine;
+            if (owner != root) {
+                share.resize((bx1 - bx0) * (by1 - by0));
+                MPI_Recv(share.data(), share.size(), MPI_UINT64_T, owner, TAG_VIEWPORT, topo.comm, MPI_STATUS_IGNORE);
+                part = &share;
+            }
+
+            for (long by = by0; by < by1; by++)
+                for (long bx = bx0; bx < bx1; bx++)
+                    result[(by - view.y) * view.width + (bx - view.x)] +=
+                        (*part)[(by - by0) * (bx1 - bx0) + (bx - bx0)];
+        }
+
+    return result;
+}
@@ -0,0 +1,106 @@
+// --------------------
+// Standard Library
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+// --------------------
+// Library Includes
+#include <omp.h>
+
+// --------------------
+// Project Includes
+#include "sector.h"
+#include "kernel.h"
+
+namespace {
+
+/// Cache line alignment; large allocations come straight from mmap, so no
+/// page is touched until sector_create writes it.
+const size_t alignment = 64;
+
+/// splitmix64 finalizer. Cheap, stateless hash used as a per cell random number.
+uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+}
+
+Sector sector_create(int width, long x0, long y0) {
+    Sector s;
+    s.width = width;
+    s.stride = width + 2;
+    s.x0 = x0;
+    s.y0 = y0;
+    s.current = 0;
+    s.kernel = kernels[0].step;
+    s.serial_kernel = kernels[0].serial;
+    s.tile = 64;
+
+    size_t bytes = (size_t) s.stride * s.stride;
+    bytes = (bytes + alignment - 1) / alignment * alignment;
+
+    for (int b = 0; b < 2; b++) {
+        s.cells[b] = (byte*) std::aligned_alloc(alignment, bytes);
+
+        /// First touch. Row y + 1 is written by the thread that will compute row y.
+        #pragma omp parallel for schedule(static)
+        for (int y = 0; y < width; y++)
+            memset(s.cells[b] + (size_t)(y + 1) * s.stride, 0, s.stride);
+
+        /// The two halo rows and the alignment padding.
+        memset(s.cells[b], 0, s.stride);
+        memset(s.cells[b] + (size_t)(width + 1) * s.stride, 0, bytes - (size_t)(width + 1) * s.stride);
+    }
+
+    return s;
+}
+
+void sector_free(Sector& s) {
+    for (int b = 0; b < 2; b++) {
+        std::free(s.cells[b]);
+        s.cells[b] = nullptr;
+    }
+}
+
+byte initial_cell(unsigned seed, int density, long gx, long gy) {
+    uint64_t r = mix(mix(seed) ^ ((uint64_t) gy << 32 | ((uint64_t) gx & 0xffffffffull)));
+    return r % density == 0 ? 1 : 0;
+}
+
+void sector_randomize(Sector& s, int density, unsigned seed) {
+    byte* cells = s.cells[s.current];
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < s.width; y++)
+        for (int x = 0; x < s.width; x++)
+            cells[cell_index(s, x, y)] = initial_cell(seed, density, s.x0 + x, s.y0 + y);
+}
+
+void sector_step_interior(const Sector& s) {
+    if (s.width > 2)
+        sector_step_region(s, 1, 1, s.width - 1, s.width - 1);
+}
+
+void sector_step_border(const Sector& s) {
+    const int w = s.width;
+    sector_step_region(s, 0, 0, w, 1);
+    if (w > 1) sector_step_region(s, 0, w - 1, w, w);
+    if (w > 2) {
+        sector_step_region(s, 0, 1, 1, w - 1);
+        sector_step_region(s, w - 1, 1, w, w - 1);
+    }
+}
+
+long sector_population(const Sector& s) {
+    const byte* cells = s.cells[s.current];
+    long total = 0;
+
+    #pragma omp parallel for schedule(static) reduction(+ : total)
+    for (int y = 0; y < s.width; y++)
+        for (int x = 0; x < s.width; x++)
+            total += cells[cell_index(s, x, y)];
+    return total;
+}
@@ -0,0 +1,208 @@
+// --------------------
+// Standard Library
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <vector>
+using std::vector;
+#include <string>
+using std::string;
+#include <cstdio>
+#include <cstring>
+
+// used for gethostname and sched_getcpu
+#include <unistd.h>
+#include <sched.h>
+
+// --------------------
+// Library Includes
+#include "mpi.h"
+#include <omp.h>
+#ifdef HAVE_HWLOC
+#include <hwloc.h>
+#endif
+
+// --------------------
+// Project Includes
+#include "topology.h"
+
+namespace {
+
+#ifdef HAVE_HWLOC
+/// hwloc discovery is expensive, so it is done once and shared.
+hwloc_topology_t machine() {
+    static hwloc_topology_t topo = nullptr;
+    if (!topo) {
+        hwloc_topology_init(&topo);
+        hwloc_topology_load(topo);
+    }
+    return topo;
+}
+
+/// The cpuset the launcher bound this rank to (or every core, if unbound),
+/// read before any pinning, which narrows the process binding, so that
+/// later calls to pin_threads still spread over the whole set.
+hwloc_const_cpuset_t launcher_cpuset() {
+    static hwloc_cpuset_t allowed = nullptr;
+    if (!allowed) {
+        allowed = hwloc_bitmap_alloc();
+        hwloc_get_cpubind(machine(), allowed, HWLOC_CPUBIND_PROCESS);
+    }
+    return allowed;
+}
+#endif
+
+/// One row of the startup report. Fixed size so it can be gathered as bytes.
+struct Placement {
+    int world_rank, cart_rank, row, col, threads;
+    char host[64];
+    char cpus[96];
+    char cpu_numa[32];
+    char mem_numa[32];
+};
+
+/// Copies s into a fixed size field, truncating with "..." if it does not fit.
+void copy_field(char* field, size_t size, const string& s) {
+    snprintf(field, size, "%s", s.c_str());
+    if (s.size() >= size && size > 4) strcpy(field + size - 4, "...");
+}
+
+}
+
+Topology topology_create(MPI_Comm parent) {
+    Topology topo;
+    MPI_Comm_rank(parent, &topo.world_rank);
+    MPI_Comm_size(parent, &topo.size);
+
+    /// Let MPI pick the most square grid for the number of ranks. The world is
+    /// not periodic: cells past the edge of the grid are always dead.
+    topo.dims[0] = topo.dims[1] = 0;
+    MPI_Dims_create(topo.size, 2, topo.dims);
+
+    int periods[2] = {0, 0};
+    MPI_Cart_create(parent, 2, topo.dims, periods, 1, &topo.comm);
+    MPI_Comm_rank(topo.comm, &topo.rank);
+    MPI_Cart_coords(topo.comm, topo.rank, 2, topo.coords);
+
+    MPI_Cart_shift(topo.comm, 0, 1, &topo.north, &topo.south);
+    MPI_Cart_shift(topo.comm, 1, 1, &topo.west, &topo.east);
+
+    /// MPI_Cart_shift only moves along one axis, so look the corners up by coordinate.
+    auto neighbour = [&](int drow, int dcol) {
+        int at[2] = {topo.coords[0] + drow, topo.coords[1] + dcol};
+        if (at[0] < 0 || at[0] >= topo.dims[0] || at[1] < 0 || at[1] >= topo.dims[1])
+            return (int) MPI_PROC_NULL;
+        int r;
+        MPI_Cart_rank(topo.comm, at, &r);
+        return r;
+    };
+    topo.north_west = neighbour(-1, -1);
+    topo.north_east = neighbour(-1, 1);
+    topo.south_west = neighbour(1, -1);
+    topo.south_east = neighbour(1, 1);
+
+    return topo;
+}
+
+void topology_free(Topology& topo) {
+    MPI_Comm_free(&topo.comm);
+}
+
+void pin_threads(const Topology& topo) {
+#ifdef HAVE_HWLOC
+    hwloc_topology_t machine_topo = machine();
+    hwloc_const_cpuset_t allowed = launcher_cpuset();
+    int units = hwloc_bitmap_weight(allowed);
+
+    if (units <= 0) {
+        if (topo.rank == 0) cout << "Pinning skipped: could not read the process cpuset" << endl;
+        return;
+    }
+
+    /// Thread t gets the t-th processing unit of the cpuset. Threads are spread
+    /// round robin if there are more threads than units.
+    #pragma omp parallel
+    {
+        int target = omp_get_thread_num() % units;
+        int unit = hwloc_bitmap_first(allowed);
+        for (int i = 0; i < target; i++)
+            unit = hwloc_bitmap_next(allowed, unit);
+
+        hwloc_cpuset_t single = hwloc_bitmap_alloc();
+        hwloc_bitmap_only(single, unit);
+        hwloc_set_cpubind(machine_topo, single, HWLOC_CPUBIND_THREAD);
+        hwloc_bitmap_free(single);
+    }
+#else
+    if (topo.rank == 0)
+        cout << "Pinning unavailable: rebuild with -DHAVE_HWLOC and -lhwloc" << endl;
+#endif
+}
+
+void report_mapping(const Topology& topo, const void* memory, size_t bytes) {
+    Placement mine;
+    memset(&mine, 0, sizeof(mine));
+    mine.world_rank = topo.world_rank;
+    mine.cart_rank = topo.rank;
+    mine.row = topo.coords[0];
+    mine.col = topo.coords[1];
+
+    char host[64] = {0};
+    gethostname(host, sizeof(host) - 1);
+    copy_field(mine.host, sizeof(mine.host), host);
+
+    /// Ask every thread where it is running right now.
+    vector<int> cpus(omp_get_max_threads(), -1);
+    #pragma omp parallel
+    cpus[omp_get_thread_num()] = sched_getcpu();
+    mine.threads = cpus.size();
+
+    string cpu_list;
+    for (size_t i = 0; i < cpus.size(); i++)
+        cpu_list += (i ? "," : "") + std::to_string(cpus[i]);
+    copy_field(mine.cpus, sizeof(mine.cpus), cpu_list);
+
+#ifdef HAVE_HWLOC
+    hwloc_topology_t machine_topo = machine();
+    char list[32];
+
+    /// NUMA nodes local to the cores the threads run on.
+    hwloc_nodeset_t cpu_nodes = hwloc_bitmap_alloc();
+    for (int cpu : cpus) {
+        hwloc_obj_t pu = hwloc_get_pu_obj_by_os_index(machine_topo, cpu);
+        if (pu) hwloc_bitmap_or(cpu_nodes, cpu_nodes, pu->nodeset);
+    }
+    hwloc_bitmap_list_snprintf(list, sizeof(list), cpu_nodes);
+    copy_field(mine.cpu_numa, sizeof(mine.cpu_numa), list);
+    hwloc_bitmap_free(cpu_nodes);
+
+    /// NUMA nodes that actually hold the sector pages.
+    hwloc_nodeset_t mem_nodes = hwloc_bitmap_alloc();
+    if (hwloc_get_area_memlocation(machine_topo, memory, bytes, mem_nodes, HWLOC_MEMBIND_BYNODESET) == 0) {
+        hwloc_bitmap_list_snprintf(list, sizeof(list), mem_nodes);
+        copy_field(mine.mem_numa, sizeof(mine.mem_numa), list);
+    }
+    else copy_field(mine.mem_numa, sizeof(mine.mem_numa), "?");
+    hwloc_bitmap_free(mem_nodes);
+#else
+    (void) memory;
+    (void) bytes;
+    copy_field(mine.cpu_numa, sizeof(mine.cpu_numa), "?");
+    copy_field(mine.mem_numa, sizeof(mine.mem_numa), "?");
+#endif
+
+    vector<Placement> all(topo.rank == 0 ? topo.size : 0);
+    MPI_Gather(&mine, sizeof(Placement), MPI_BYTE, all.data(), sizeof(Placement), MPI_BYTE, 0, topo.comm);
+
+    if (topo.rank != 0) return;
+
+    cout << "Process grid " << topo.dims[0] << " x " << topo.dims[1] << endl;
+    printf("%6s %6s %9s  %-20s %-8s %-8s %s\n", "world", "cart", "row,col", "host", "numa", "memory", "cpus");
+    for (const Placement& p : all) {
+        char pos[16];
+        snprintf(pos, sizeof(pos), "%d,%d", p.row, p.col);
+        printf("%6d %6d %9s  %-20s %-8s %-8s %s\n",
+            p.world_rank, p.cart_rank, pos, p.host, p.cpu_numa, p.mem_numa, p.cpus);
+    }
+    fflush(stdout);
+}